@@ -0,0 +1,503 @@
+﻿#include "audio.h"
+
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <mmsystem.h>
+#endif
+
+/* === 預先合成的音效 ===
+ * 沒有素材檔, 啟動時用簡單波形合成; 混音時只做加法, 不再解碼或計算波形. */
+typedef enum {
+    WAVE_SINE,
+    WAVE_SQUARE,
+    WAVE_NOISE      /* f0 為低通截止頻率 */
+} WaveType;
+
+typedef struct {
+    WaveType wave;
+    double duration;    /* 秒 */
+    double f0, f1;      /* 起始 / 結束頻率 (Hz) */
+    double volume;      /* 0..1 */
+} SoundDef;
+
+/* 以 AudioSound 為索引 */
+static const SoundDef sound_defs[SOUND_COUNT] = {
+    { WAVE_SQUARE, 0.08, 1200.0, 600.0, 0.20 },  /* SOUND_SHOOT */
+    { WAVE_NOISE,  0.25, 2500.0,   0.0, 0.50 },  /* SOUND_HIT */
+    { WAVE_SQUARE, 0.18,  600.0, 150.0, 0.30 },  /* SOUND_KILL */
+    { WAVE_SINE,   0.80,  110.0,  55.0, 0.60 },  /* SOUND_BOSS_SPAWN */
+    { WAVE_NOISE,  1.20,  600.0,   0.0, 0.70 },  /* SOUND_BOSS_KILL */
+};
+
+typedef struct {
+    gint16* pcm;
+    int frames;
+} AudioSample;
+
+typedef struct {
+    const AudioSample* sample;  /* NULL = 空閒 */
+    int pos;
+} AudioVoice;
+
+struct Audio {
+    AudioSink* sink;
+    GThread* thread;
+    gint quit;
+
+    AudioSample samples[SOUND_COUNT];
+
+    /* SPSC 佇列: head 只由遊戲執行緒寫, tail 只由混音執行緒寫.
+     * 兩者隔開一條 cache line, 避免互相干擾 */
+    guint8 ring[AUDIO_RING_SIZE];
+    gint head;
+    char pad[64];
+    gint tail;
+
+    /* 以下只有混音執行緒使用 */
+    AudioVoice voices[AUDIO_MAX_VOICES];
+    gint32 mix[AUDIO_BLOCK_FRAMES];
+    gint16 out[AUDIO_BLOCK_FRAMES];
+    gint block_ns[AUDIO_STATS_WINDOW];
+    gint64 block_ns_sum;
+    int block_head;
+    int block_count;
+    gboolean sink_failed;
+
+    /* 統計 (atomic) */
+    gint blocks;
+    gint underruns;
+    gint dropped_events;
+    gint active_voices;
+    gint block_avg_ns;
+    gint block_max_ns;
+};
+
+static void sample_synth(AudioSample* s, const SoundDef* def, GRand* rng)
+{
+    s->frames = (int)(def->duration * AUDIO_RATE);
+    s->pcm = g_new(gint16, s->frames);
+
+    double phase = 0.0;
+    double lp = 0.0;
+    double alpha = 1.0 - exp(-2.0 * G_PI * def->f0 / AUDIO_RATE);
+    for (int i = 0; i < s->frames; i++) {
+        double t = (double)i / s->frames;
+        double freq = def->f0 + (def->f1 - def->f0) * t;
+        double v;
+
+        switch (def->wave) {
+        case WAVE_SINE:
+            v = sin(phase);
+            break;
+        case WAVE_SQUARE:
+            v = phase < G_PI ? 1.0 : -1.0;
+            break;
+        default:
+            lp += alpha * (g_rand_double_range(rng, -1.0, 1.0) - lp);
+            v = lp * 2.0;
+            break;
+        }
+        phase += 2.0 * G_PI * freq / AUDIO_RATE;
+        if (phase >= 2.0 * G_PI) phase -= 2.0 * G_PI;
+
+        /* 5 ms 淡入, 之後線性淡出 */
+        double attack = MIN(1.0, i / (0.005 * AUDIO_RATE));
+        double env = attack * (1.0 - t);
+        s->pcm[i] = (gint16)CLAMP(v * env * def->volume * 32767.0, -32768.0, 32767.0);
+    }
+}
+
+/* === 混音執行緒 === */
+static void mixer_take_events(Audio* a)
+{
+    guint tail = (guint)a->tail;
+    guint head = (guint)g_atomic_int_get(&a->head);
+
+    for (; tail != head; tail++) {
+        const AudioSample* s = &a->samples[a->ring[tail & (AUDIO_RING_SIZE - 1)]];
+
+        /* 找空閒的 voice, 沒有就搶播放最久的那個 */
+        AudioVoice* v = &a->voices[0];
+        for (int i = 0; i < AUDIO_MAX_VOICES; i++) {
+            if (!a->voices[i].sample) { v = &a->voices[i]; break; }
+            if (a->voices[i].pos > v->pos) v = &a->voices[i];
+        }
+        v->sample = s;
+        v->pos = 0;
+    }
+    g_atomic_int_set(&a->tail, (gint)tail);
+}
+
+static void mixer_render(Audio* a)
+{
+    int active = 0;
+    memset(a->mix, 0, sizeof(a->mix));
+
+    for (int i = 0; i < AUDIO_MAX_VOICES; i++) {
+        AudioVoice* v = &a->voices[i];
+        if (!v->sample) continue;
+
+        int n = MIN(AUDIO_BLOCK_FRAMES, v->sample->frames - v->pos);
+        const gint16* src = v->sample->pcm + v->pos;
+        for (int k = 0; k < n; k++) a->mix[k] += src[k];
+
+        v->pos += n;
+        if (v->pos >= v->sample->frames) v->sample = NULL;
+        else active++;
+    }
+
+    for (int k = 0; k < AUDIO_BLOCK_FRAMES; k++) {
+        a->out[k] = (gint16)CLAMP(a->mix[k], -32768, 32767);
+    }
+    g_atomic_int_set(&a->active_voices, active);
+}
+
+static void mixer_record_block(Audio* a, gint64 ns)
+{
+    if (a->block_count == AUDIO_STATS_WINDOW) {
+        a->block_ns_sum -= a->block_ns[a->block_head];
+    }
+    else {
+        a->block_count++;
+    }
+    a->block_ns[a->block_head] = (gint)ns;
+    a->block_ns_sum += ns;
+    a->block_head = (a->block_head + 1) % AUDIO_STATS_WINDOW;
+
+    gint max = 0;
+    for (int i = 0; i < a->block_count; i++) {
+        if (a->block_ns[i] > max) max = a->block_ns[i];
+    }
+    g_atomic_int_set(&a->block_avg_ns, (gint)(a->block_ns_sum / a->block_count));
+    g_atomic_int_set(&a->block_max_ns, max);
+    g_atomic_int_inc(&a->blocks);
+}
+
+/* 音效卡輸出端自己會等 (write 阻塞到有空的緩衝區), underrun 由裝置回報.
+ * 其他輸出端依牆上時鐘消耗 block (模擬音效卡); 最多領先 AUDIO_LATENCY_BLOCKS 個,
+ * 落後代表輸出端已經沒東西可播 => underrun */
+static gpointer mixer_thread(gpointer data)
+{
+    Audio* a = (Audio*)data;
+    gint64 start = g_get_monotonic_time();
+    gint64 produced = 0;
+
+#ifdef _WIN32
+    /* 預設計時器解析度約 15.6 ms, 比一個 block (5.8 ms) 還粗, g_usleep (Sleep) 會睡過頭 */
+    timeBeginPeriod(1);
+#endif
+
+    while (!g_atomic_int_get(&a->quit)) {
+        gint64 t0 = g_get_monotonic_time();
+        mixer_take_events(a);
+        mixer_render(a);
+        mixer_record_block(a, (g_get_monotonic_time() - t0) * 1000);
+
+        if (!a->sink->write(a->sink, a->out, AUDIO_BLOCK_FRAMES) && !a->sink_failed) {
+            g_print("[AUDIO] %s sink: write failed, output stops here\n", a->sink->name);
+            a->sink_failed = TRUE;
+        }
+
+        if (a->sink->underruns && !a->sink_failed) {
+            g_atomic_int_set(&a->underruns, (gint)a->sink->underruns(a->sink));
+            /* 裝置出錯後改用模擬計時, 從這裡重新起算 */
+            start = g_get_monotonic_time();
+            produced = 0;
+            continue;
+        }
+        produced++;
+
+        gint64 now = g_get_monotonic_time();
+        gint64 played = (now - start) * AUDIO_RATE / (G_USEC_PER_SEC * AUDIO_BLOCK_FRAMES);
+        if (played > produced) {
+            /* 重新對齊時鐘, 同一次落後只算一次 */
+            g_atomic_int_inc(&a->underruns);
+            start = now - produced * AUDIO_BLOCK_FRAMES * G_USEC_PER_SEC / AUDIO_RATE;
+        }
+        else if (produced - played >= AUDIO_LATENCY_BLOCKS) {
+            gint64 wake = start +
+                (produced - AUDIO_LATENCY_BLOCKS + 1) * AUDIO_BLOCK_FRAMES * G_USEC_PER_SEC / AUDIO_RATE;
+            if (wake > now) g_usleep((gulong)(wake - now));
+        }
+    }
+
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+    return NULL;
+}
+
+/* === 對外介面 === */
+Audio* audio_new(AudioSink* sink)
+{
+    Audio* a = g_new0(Audio, 1);
+    a->sink = sink;
+
+    GRand* rng = g_rand_new_with_seed(1);
+    for (int i = 0; i < SOUND_COUNT; i++) {
+        sample_synth(&a->samples[i], &sound_defs[i], rng);
+    }
+    g_rand_free(rng);
+
+    a->thread = g_thread_new("audio-mixer", mixer_thread, a);
+    return a;
+}
+
+void audio_free(Audio* a)
+{
+    if (!a) return;
+
+    g_atomic_int_set(&a->quit, 1);
+    g_thread_join(a->thread);
+    a->sink->close(a->sink);
+
+    for (int i = 0; i < SOUND_COUNT; i++) {
+        g_free(a->samples[i].pcm);
+    }
+    g_free(a);
+}
+
+gboolean audio_post(Audio* a, AudioSound sound)
+{
+    guint head = (guint)a->head;
+    guint tail = (guint)g_atomic_int_get(&a->tail);
+
+    if (head - tail >= AUDIO_RING_SIZE) {
+        g_atomic_int_inc(&a->dropped_events);
+        return FALSE;
+    }
+    a->ring[head & (AUDIO_RING_SIZE - 1)] = (guint8)sound;
+
+    /* 先寫內容再推進 head (g_atomic_int_set 帶記憶體屏障) */
+    g_atomic_int_set(&a->head, (gint)(head + 1));
+    return TRUE;
+}
+
+void audio_get_stats(Audio* a, AudioStats* out)
+{
+    out->blocks = (guint)g_atomic_int_get(&a->blocks);
+    out->underruns = (guint)g_atomic_int_get(&a->underruns);
+    out->dropped_events = (guint)g_atomic_int_get(&a->dropped_events);
+    out->active_voices = (guint)g_atomic_int_get(&a->active_voices);
+    out->block_avg_ms = g_atomic_int_get(&a->block_avg_ns) / 1e6;
+    out->block_max_ms = g_atomic_int_get(&a->block_max_ns) / 1e6;
+}
+
+const char* audio_sink_name(Audio* a)
+{
+    return a->sink->name;
+}
+
+/* === null sink === */
+static gboolean null_sink_write(AudioSink* sink, const gint16* pcm, int frames)
+{
+    return TRUE;
+}
+
+static void null_sink_close(AudioSink* sink)
+{
+    g_free(sink);
+}
+
+AudioSink* audio_sink_null_new(void)
+{
+    AudioSink* sink = g_new0(AudioSink, 1);
+    sink->name = "null";
+    sink->write = null_sink_write;
+    sink->close = null_sink_close;
+    return sink;
+}
+
+/* === WAV sink === */
+typedef struct {
+    AudioSink base;
+    FILE* fp;
+    guint32 data_bytes;
+} WavSink;
+
+static void put_le16(guint8* p, guint16 v) { p[0] = v & 0xff; p[1] = v >> 8; }
+static void put_le32(guint8* p, guint32 v) { put_le16(p, v & 0xffff); put_le16(p + 2, v >> 16); }
+
+/* 44 bytes 的 PCM 檔頭; 長度欄位在 close 時回填 */
+static void wav_header(guint8* h, guint32 data_bytes)
+{
+    memcpy(h, "RIFF", 4);
+    put_le32(h + 4, 36 + data_bytes);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    put_le32(h + 16, 16);
+    put_le16(h + 20, 1);                     /* PCM */
+    put_le16(h + 22, 1);                     /* 單聲道 */
+    put_le32(h + 24, AUDIO_RATE);
+    put_le32(h + 28, AUDIO_RATE * 2);        /* byte rate */
+    put_le16(h + 32, 2);                     /* block align */
+    put_le16(h + 34, 16);                    /* bits */
+    memcpy(h + 36, "data", 4);
+    put_le32(h + 40, data_bytes);
+}
+
+static gboolean wav_sink_write(AudioSink* sink, const gint16* pcm, int frames)
+{
+    WavSink* w = (WavSink*)sink;
+    guint8 buf[AUDIO_BLOCK_FRAMES * 2];
+
+    while (frames > 0) {
+        int n = MIN(frames, AUDIO_BLOCK_FRAMES);
+        for (int i = 0; i < n; i++) put_le16(buf + i * 2, (guint16)pcm[i]);
+        if (fwrite(buf, 2, n, w->fp) != (size_t)n) return FALSE;
+        w->data_bytes += n * 2;
+        pcm += n;
+        frames -= n;
+    }
+    return TRUE;
+}
+
+static void wav_sink_close(AudioSink* sink)
+{
+    WavSink* w = (WavSink*)sink;
+    guint8 h[44];
+    wav_header(h, w->data_bytes);
+    if (fseek(w->fp, 0, SEEK_SET) == 0) fwrite(h, 1, sizeof(h), w->fp);
+    fclose(w->fp);
+    g_free(w);
+}
+
+AudioSink* audio_sink_wav_new(const char* path, GError** error)
+{
+    FILE* fp = g_fopen(path, "wb");
+    if (!fp) {
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno),
+            "cannot open %s", path);
+        return NULL;
+    }
+
+    guint8 h[44];
+    wav_header(h, 0);
+    fwrite(h, 1, sizeof(h), fp);
+
+    WavSink* w = g_new0(WavSink, 1);
+    w->base.name = "wav";
+    w->base.write = wav_sink_write;
+    w->base.close = wav_sink_close;
+    w->fp = fp;
+    return &w->base;
+}
+
+/* === 音效卡 (Windows waveOut) ===
+ * 固定幾個 block 大小的緩衝區輪流送給裝置; write 等到下一個緩衝區播完才覆寫,
+ * 所以混音執行緒的速度由音效卡決定. 送出新 block 時若所有緩衝區都已播完,
+ * 代表裝置曾經沒東西可播, 算一次 underrun. */
+#ifdef _WIN32
+#define WAVEOUT_BUFFERS     (AUDIO_LATENCY_BLOCKS + 2)  /* waveOut 本身有延遲, 比模擬多留兩個 */
+#define WAVEOUT_TIMEOUT_MS  500                         /* 等這麼久還沒播完就當作裝置停了 */
+
+typedef struct {
+    AudioSink base;
+    HWAVEOUT dev;
+    HANDLE done;                /* 裝置播完一個緩衝區就觸發 (auto-reset) */
+    WAVEHDR hdr[WAVEOUT_BUFFERS];
+    gint16 pcm[WAVEOUT_BUFFERS][AUDIO_BLOCK_FRAMES];
+    int next;
+    gboolean started;
+    guint underruns;
+} WaveOutSink;
+
+static gboolean waveout_sink_write(AudioSink* sink, const gint16* pcm, int frames)
+{
+    WaveOutSink* w = (WaveOutSink*)sink;
+    WAVEHDR* h = &w->hdr[w->next];
+
+    if (w->started) {
+        int queued = 0;
+        for (int i = 0; i < WAVEOUT_BUFFERS; i++) {
+            if (w->hdr[i].dwFlags & WHDR_INQUEUE) queued++;
+        }
+        if (queued == 0) w->underruns++;
+    }
+
+    while (h->dwFlags & WHDR_INQUEUE) {
+        if (WaitForSingleObject(w->done, WAVEOUT_TIMEOUT_MS) != WAIT_OBJECT_0) return FALSE;
+    }
+
+    frames = MIN(frames, AUDIO_BLOCK_FRAMES);
+    memcpy(w->pcm[w->next], pcm, frames * sizeof(gint16));
+    h->dwBufferLength = frames * sizeof(gint16);
+    if (waveOutWrite(w->dev, h, sizeof(WAVEHDR)) != MMSYSERR_NOERROR) return FALSE;
+
+    w->next = (w->next + 1) % WAVEOUT_BUFFERS;
+    w->started = TRUE;
+    return TRUE;
+}
+
+static guint waveout_sink_underruns(AudioSink* sink)
+{
+    return ((WaveOutSink*)sink)->underruns;
+}
+
+static void waveout_sink_close(AudioSink* sink)
+{
+    WaveOutSink* w = (WaveOutSink*)sink;
+
+    /* reset 會把還在排隊的緩衝區標成完成, 之後才能 unprepare */
+    waveOutReset(w->dev);
+    for (int i = 0; i < WAVEOUT_BUFFERS; i++) {
+        waveOutUnprepareHeader(w->dev, &w->hdr[i], sizeof(WAVEHDR));
+    }
+    waveOutClose(w->dev);
+    CloseHandle(w->done);
+    g_free(w);
+}
+
+AudioSink* audio_sink_device_new(GError** error)
+{
+    WAVEFORMATEX fmt = { 0 };
+    fmt.wFormatTag = WAVE_FORMAT_PCM;
+    fmt.nChannels = 1;
+    fmt.nSamplesPerSec = AUDIO_RATE;
+    fmt.wBitsPerSample = 16;
+    fmt.nBlockAlign = 2;
+    fmt.nAvgBytesPerSec = AUDIO_RATE * 2;
+
+    WaveOutSink* w = g_new0(WaveOutSink, 1);
+    w->done = CreateEventA(NULL, FALSE, FALSE, NULL);
+    if (!w->done) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+            "CreateEvent failed (%lu)", GetLastError());
+        g_free(w);
+        return NULL;
+    }
+
+    MMRESULT r = waveOutOpen(&w->dev, WAVE_MAPPER, &fmt, (DWORD_PTR)w->done, 0, CALLBACK_EVENT);
+    if (r != MMSYSERR_NOERROR) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+            "waveOutOpen failed (%u)", (unsigned)r);
+        CloseHandle(w->done);
+        g_free(w);
+        return NULL;
+    }
+
+    for (int i = 0; i < WAVEOUT_BUFFERS; i++) {
+        w->hdr[i].lpData = (LPSTR)w->pcm[i];
+        w->hdr[i].dwBufferLength = sizeof(w->pcm[i]);
+        waveOutPrepareHeader(w->dev, &w->hdr[i], sizeof(WAVEHDR));
+    }
+
+    w->base.name = "waveout";
+    w->base.write = waveout_sink_write;
+    w->base.close = waveout_sink_close;
+    w->base.underruns = waveout_sink_underruns;
+    return &w->base;
+}
+#else
+AudioSink* audio_sink_device_new(GError** error)
+{
+    g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+        "no audio device sink on this platform");
+    return NULL;
+}
+#endif
@@ -0,0 +1,64 @@
+﻿#pragma once
+/* === 音效 ===
+ * 獨立的混音執行緒: 音效在啟動時先合成成 PCM, 之後以固定大小的 block 混音,
+ * 交給輸出端 (AudioSink). 遊戲執行緒只把事件丟進單一生產者/單一消費者的
+ * 環狀佇列, 不上鎖也不等待; 佇列滿了就丟掉該事件並計數. */
+
+#include <glib.h>
+
+#define AUDIO_RATE           44100  /* 取樣率 (單聲道 16-bit) */
+#define AUDIO_BLOCK_FRAMES   256    /* 每個 block 的取樣數 (約 5.8 ms) */
+#define AUDIO_LATENCY_BLOCKS 2      /* 最多領先輸出端幾個 block */
+#define AUDIO_RING_SIZE      256    /* 事件佇列大小, 需為 2 的次方 */
+#define AUDIO_MAX_VOICES     16     /* 同時發聲數, 滿了就搶最舊的 */
+#define AUDIO_STATS_WINDOW   256    /* block 耗時的統計視窗 */
+
+typedef enum {
+    SOUND_SHOOT,
+    SOUND_HIT,
+    SOUND_KILL,
+    SOUND_BOSS_SPAWN,
+    SOUND_BOSS_KILL,
+    SOUND_COUNT
+} AudioSound;
+
+/* 輸出端: 混音執行緒每個 block 呼叫一次 write; close 負責收尾並釋放自己.
+ * underruns 為 NULL 的輸出端 (null / WAV) 不會等待, 由混音執行緒依牆上時鐘模擬播放速度;
+ * 真正的音效卡在 write 裡等到有空的緩衝區才回傳, underrun 次數由它自己回報. */
+typedef struct AudioSink AudioSink;
+struct AudioSink {
+    const char* name;
+    gboolean (*write)(AudioSink* sink, const gint16* pcm, int frames);
+    void (*close)(AudioSink* sink);
+    guint (*underruns)(AudioSink* sink);
+};
+
+/* 丟棄輸出 (只跑混音與計時) */
+AudioSink* audio_sink_null_new(void);
+/* 寫成 WAV 檔 (44.1 kHz 單聲道 16-bit), close 時補上檔頭長度 */
+AudioSink* audio_sink_wav_new(const char* path, GError** error);
+/* 預設音效卡 (Windows waveOut); 其他平台回傳 NULL 並設定 error */
+AudioSink* audio_sink_device_new(GError** error);
+
+/* 統計 (混音執行緒寫入, 任何執行緒都可讀取快照) */
+typedef struct {
+    guint blocks;
+    guint underruns;        /* 輸出端沒東西可播的次數 (音效卡由裝置回報, 其他為模擬) */
+    guint dropped_events;   /* 佇列滿而丟掉的事件 */
+    guint active_voices;
+    double block_avg_ms;    /* 最近 AUDIO_STATS_WINDOW 個 block 的平均混音耗時 */
+    double block_max_ms;
+} AudioStats;
+
+typedef struct Audio Audio;
+
+/* 建立並啟動混音執行緒; sink 交由 Audio 負責關閉 */
+Audio* audio_new(AudioSink* sink);
+/* 停止執行緒並關閉 sink */
+void audio_free(Audio* audio);
+
+/* 遊戲執行緒呼叫, 不會阻塞; 佇列滿回傳 FALSE */
+gboolean audio_post(Audio* audio, AudioSound sound);
+
+void audio_get_stats(Audio* audio, AudioStats* out);
+const char* audio_sink_name(Audio* audio);
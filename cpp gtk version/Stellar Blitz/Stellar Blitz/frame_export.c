@@ -0,0 +1,207 @@
+﻿#include "frame_export.h"
+#include "frame_shm.h"
+
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+struct FrameExport {
+    FrameShm* shm;
+#ifdef _WIN32
+    HANDLE mapping;
+#endif
+    guint32 frame;
+
+    /* 發布耗時的滾動視窗 */
+    gint64 publish_us[FRAME_EXPORT_STATS_WINDOW];
+    gint64 publish_sum;
+    int head;
+    int count;
+    guint truncated;
+};
+
+/* === 建立 / 釋放共享記憶體 === */
+FrameExport* frame_export_open(GError** error)
+{
+    FrameShm* shm;
+    FrameExport* fx = g_new0(FrameExport, 1);
+
+#ifdef _WIN32
+    fx->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+        0, (DWORD)sizeof(FrameShm), FRAME_SHM_NAME);
+    if (!fx->mapping) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+            "CreateFileMapping %s failed (%lu)", FRAME_SHM_NAME, GetLastError());
+        g_free(fx);
+        return NULL;
+    }
+    shm = (FrameShm*)MapViewOfFile(fx->mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(FrameShm));
+    if (!shm) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+            "MapViewOfFile %s failed (%lu)", FRAME_SHM_NAME, GetLastError());
+        CloseHandle(fx->mapping);
+        g_free(fx);
+        return NULL;
+    }
+#else
+    int fd = shm_open(FRAME_SHM_NAME, O_CREAT | O_RDWR, 0600);
+    if (fd < 0 || ftruncate(fd, sizeof(FrameShm)) < 0) {
+        int err = errno;
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(err),
+            "shm %s: %s", FRAME_SHM_NAME, g_strerror(err));
+        if (fd >= 0) close(fd);
+        g_free(fx);
+        return NULL;
+    }
+    shm = (FrameShm*)mmap(NULL, sizeof(FrameShm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm == MAP_FAILED) {
+        int err = errno;
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(err),
+            "mmap %s: %s", FRAME_SHM_NAME, g_strerror(err));
+        g_free(fx);
+        return NULL;
+    }
+#endif
+
+    /* 可能是上次留下的區段: 先讓讀取端看不到, 重設後最後才寫 magic */
+    shm->magic = 0;
+    FRAME_SHM_FENCE();
+    shm->version = FRAME_SHM_VERSION;
+    shm->slot_count = FRAME_SHM_SLOTS;
+    shm->slot_size = sizeof(FrameSlot);
+    shm->epoch = g_get_real_time();
+    shm->latest = 0;
+    for (int i = 0; i < FRAME_SHM_SLOTS; i++) {
+        shm->slots[i].seq = 0;
+    }
+    FRAME_SHM_FENCE();
+    shm->magic = FRAME_SHM_MAGIC;
+
+    fx->shm = shm;
+    g_print("[EXPORT] publishing to shared memory %s, %d slots x %d bytes\n",
+        FRAME_SHM_NAME, FRAME_SHM_SLOTS, (int)sizeof(FrameSlot));
+    return fx;
+}
+
+void frame_export_close(FrameExport* fx)
+{
+    if (!fx) return;
+
+    fx->shm->magic = 0;
+#ifdef _WIN32
+    UnmapViewOfFile(fx->shm);
+    CloseHandle(fx->mapping);
+#else
+    munmap(fx->shm, sizeof(FrameShm));
+    shm_unlink(FRAME_SHM_NAME);
+#endif
+    g_free(fx);
+}
+
+/* === 每幀發布 === */
+/* 視野內的一個實體 (含半徑) 寫入 slot; 滿了回傳 FALSE */
+static gboolean slot_push(FrameSlot* slot, int* n, const GameData* gd, double x, double y, double r)
+{
+    if (x + r < gd->cam_x || x - r > gd->cam_x + WINDOW_WIDTH ||
+        y + r < gd->cam_y || y - r > gd->cam_y + WINDOW_HEIGHT) {
+        return TRUE;
+    }
+    if (*n >= FRAME_SHM_MAX_ENTITIES) return FALSE;
+
+    slot->entities[*n].x = (float)x;
+    slot->entities[*n].y = (float)y;
+    (*n)++;
+    return TRUE;
+}
+
+void frame_export_publish(FrameExport* fx, const GameData* gd)
+{
+    gint64 t0 = g_get_monotonic_time();
+    FrameShm* shm = fx->shm;
+    guint32 frame = ++fx->frame;
+    FrameSlot* slot = &shm->slots[frame % FRAME_SHM_SLOTS];
+    gboolean full = FALSE;
+    int n = 0;
+
+    /* 寫入中 */
+    slot->seq = 2 * frame - 1;
+    FRAME_SHM_FENCE();
+
+    slot->frame = frame;
+    slot->time_us = t0;
+    slot->mode = gd->mode;
+    slot->hp = gd->hp;
+    slot->score = gd->score;
+    slot->kills = gd->enemies_killed;
+    slot->time_left = (float)gd->time_left;
+    slot->cam_x = (float)gd->cam_x;
+    slot->cam_y = (float)gd->cam_y;
+    slot->player_x = (float)gd->player_x;
+    slot->player_y = (float)gd->player_y;
+    slot->world_width = gd->width;
+    slot->world_height = gd->height;
+
+    /* 普通敵機: 與 draw_scene 相同, 只走視野涵蓋的區塊 */
+    int cx0, cy0, cx1, cy1;
+    double r = ENEMY_SIZE;
+    game_chunk_range(gd, gd->cam_x - r, gd->cam_y - r,
+        gd->cam_x + WINDOW_WIDTH + r, gd->cam_y + WINDOW_HEIGHT + r, &cx0, &cy0, &cx1, &cy1);
+    for (int cy = cy0; cy <= cy1 && !full; cy++) {
+        for (int cx = cx0; cx <= cx1 && !full; cx++) {
+            const Chunk* ch = &gd->chunks[cy * gd->chunk_cols + cx];
+            for (int i = 0; i < ch->count && !full; i++) {
+                const Enemy* e = &gd->enemies[ch->items[i]];
+                full = !slot_push(slot, &n, gd, e->x, e->y, r);
+            }
+        }
+    }
+    slot->n_enemies = (uint16_t)n;
+
+    for (int i = 0; i < gd->bullet_count && !full; i++) {
+        full = !slot_push(slot, &n, gd, gd->bullets[i].x, gd->bullets[i].y, BULLET_SIZE);
+    }
+    slot->n_bullets = (uint16_t)(n - slot->n_enemies);
+
+    for (int i = 0; i < gd->boss_count && !full; i++) {
+        full = !slot_push(slot, &n, gd, gd->bosses[i].x, gd->bosses[i].y, ENEMY_SIZE * BOSS_SIZE_RATIO);
+    }
+    slot->n_bosses = (uint16_t)(n - slot->n_enemies - slot->n_bullets);
+
+    slot->flags = (full ? FRAME_FLAG_TRUNCATED : 0) |
+        (gd->state != STATE_GAME ? FRAME_FLAG_GAME_OVER : 0);
+    if (full) fx->truncated++;
+
+    /* 完成 => 公開 */
+    FRAME_SHM_FENCE();
+    slot->seq = 2 * frame;
+    shm->latest = frame;
+
+    gint64 us = g_get_monotonic_time() - t0;
+    if (fx->count == FRAME_EXPORT_STATS_WINDOW) {
+        fx->publish_sum -= fx->publish_us[fx->head];
+    }
+    else {
+        fx->count++;
+    }
+    fx->publish_us[fx->head] = us;
+    fx->publish_sum += us;
+    fx->head = (fx->head + 1) % FRAME_EXPORT_STATS_WINDOW;
+}
+
+void frame_export_get_stats(FrameExport* fx, FrameExportStats* out)
+{
+    gint64 max = 0;
+    for (int i = 0; i < fx->count; i++) {
+        if (fx->publish_us[i] > max) max = fx->publish_us[i];
+    }
+    out->frames = fx->frame;
+    out->publish_avg_us = fx->count > 0 ? (double)fx->publish_sum / fx->count : 0.0;
+    out->publish_max_us = (double)max;
+    out->truncated = fx->truncated;
+}
@@ -0,0 +1,25 @@
+﻿#pragma once
+/* === 畫面快照輸出 (共享記憶體環狀緩衝) ===
+ * 每幀把鏡頭內的實體直接寫進共享記憶體的 slot (格式見 frame_shm.h),
+ * 不經過中間緩衝, 不上鎖, 也不等讀取端. */
+
+#include <glib.h>
+
+#include "game.h"
+
+#define FRAME_EXPORT_STATS_WINDOW 120
+
+typedef struct {
+    guint frames;
+    double publish_avg_us;      /* 最近 FRAME_EXPORT_STATS_WINDOW 幀 */
+    double publish_max_us;
+    guint truncated;            /* 實體太多被截斷的幀數 */
+} FrameExportStats;
+
+typedef struct FrameExport FrameExport;
+
+FrameExport* frame_export_open(GError** error);
+void frame_export_close(FrameExport* fx);
+
+void frame_export_publish(FrameExport* fx, const GameData* gd);
+void frame_export_get_stats(FrameExport* fx, FrameExportStats* out);
@@ -0,0 +1,69 @@
+﻿#pragma once
+/* === 共享記憶體畫面輸出的資料格式 ===
+ * 遊戲 (frame_export.c) 與讀取端 (spectator/) 共用; 不依賴 GLib.
+ *
+ * 共有 FRAME_SHM_SLOTS 個 slot 組成環狀緩衝, 第 n 幀寫在 slot n % FRAME_SHM_SLOTS.
+ * 每個 slot 以 seq 當 seqlock:
+ *   寫入端: seq = 2n-1 (寫入中) -> 寫內容 -> seq = 2n -> latest = n
+ *   讀取端: 讀 latest, 讀 seq, 複製內容, 再讀一次 seq; 兩次都等於 2*latest 才算完整,
+ *           否則代表剛好被覆寫, 丟掉重讀.
+ * 寫入端從不等待讀取端; 讀取端太慢只會跳過 (漏掉) 幾幀. */
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define FRAME_SHM_NAME      "Local\\stellar_blitz_frames"
+#define FRAME_SHM_FENCE()   MemoryBarrier()
+#else
+#define FRAME_SHM_NAME      "/stellar_blitz_frames"
+#define FRAME_SHM_FENCE()   __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+#define FRAME_SHM_MAGIC         0x52464253u   /* "SBFR" */
+#define FRAME_SHM_VERSION       1
+#define FRAME_SHM_SLOTS         8
+#define FRAME_SHM_MAX_ENTITIES  1024
+
+/* FrameSlot.flags */
+#define FRAME_FLAG_TRUNCATED    0x1   /* 實體超過 FRAME_SHM_MAX_ENTITIES, 後面的沒寫入 */
+#define FRAME_FLAG_GAME_OVER    0x2   /* 這一幀結束了一局 */
+
+/* 地圖座標 */
+typedef struct {
+    float x, y;
+} FrameEntity;
+
+/* 一幀的快照: 只含鏡頭視野內的實體 (與畫面上看到的相同) */
+typedef struct {
+    volatile uint32_t seq;
+    uint32_t frame;
+    int64_t time_us;            /* 寫入時的 monotonic 時間 */
+
+    int32_t mode;
+    int32_t hp;
+    int32_t score;
+    int32_t kills;
+    float time_left;
+    float cam_x, cam_y;
+    float player_x, player_y;
+    int32_t world_width, world_height;
+
+    /* entities 依序放 enemies, bullets, bosses */
+    uint16_t n_enemies;
+    uint16_t n_bullets;
+    uint16_t n_bosses;
+    uint16_t flags;
+    FrameEntity entities[FRAME_SHM_MAX_ENTITIES];
+} FrameSlot;
+
+typedef struct {
+    volatile uint32_t magic;    /* 最後寫入; 讀取端看到才開始讀 */
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;
+    int64_t epoch;              /* 寫入端建立時間, 換了代表遊戲重開 */
+    volatile uint32_t latest;   /* 最新完成的幀編號, 0 = 還沒有 */
+    uint32_t reserved;
+    FrameSlot slots[FRAME_SHM_SLOTS];
+} FrameShm;
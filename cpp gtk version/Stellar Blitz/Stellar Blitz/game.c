@@ -0,0 +1,1020 @@
+﻿#include "game.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 內部工具 */
+static void entity_storage_reserve(GameData* gd);
+static double rand_range(double min, double max);
+static gboolean circle_collide(double x1, double y1, double r1,
+    double x2, double y2, double r2);
+static int bullet_find_hit(const Bullet* bullets, int count, double x, double y, double r);
+static void bullet_init(Bullet* b, double x, double y, double speed);
+static void enemy_init_normal(GameData* gd, Enemy* e, double speed);
+static void enemy_init_boss(GameData* gd, Enemy* e);
+static void camera_follow(GameData* gd);
+static int chunk_of(const GameData* gd, double x, double y);
+static void chunk_push(GameData* gd, int c, int idx);
+static void chunk_remove_at(GameData* gd, int c, int slot);
+static void chunks_clear(GameData* gd);
+static void wheel_schedule(GameData* gd, int idx);
+static void wheel_cancel(GameData* gd, int idx);
+static Enemy* enemy_add(GameData* gd);
+static void enemy_remove(GameData* gd, int idx);
+static gboolean enemy_rebucket(GameData* gd, int idx);
+static void enemy_catch_up(GameData* gd, Enemy* e);
+static gboolean enemy_in_world(const GameData* gd, const Enemy* e);
+static void update_wheel(GameData* gd);
+static gboolean can_player_fire(GameData* gd);
+static void game_emit(GameData* gd, GameEventType ev);
+static void update_mode_specific(GameData* gd, double dt);
+
+/* === 執行期參數 === */
+void tuning_set_defaults(Tuning* t)
+{
+    t->game_tick_ms = GAME_TICK_MS;
+    t->player_speed = PLAYER_SPEED;
+    t->bullet_speed = BULLET_SPEED;
+    t->bullet_cooldown = BULLET_COOLDOWN;
+    t->enemy_speed = ENEMY_SPEED;
+    t->enemy_spawn_interval = ENEMY_SPAWN_INTERVAL;
+    t->boss_hp = BOSS_HP;
+    t->time_attack_limit = TIME_ATTACK_LIMIT;
+    t->conquest_kill_target = CONQUEST_KILL_TARGET;
+    t->max_enemies = MAX_ENEMIES;
+    t->max_bullets = MAX_BULLETS;
+    t->world_width = WORLD_WIDTH;
+    t->world_height = WORLD_HEIGHT;
+}
+
+#define TF_INT(name, group, key, min, max) \
+    { #name, group, key, offsetof(Tuning, name), TRUE, min, max }
+#define TF_DOUBLE(name, group, key, min, max) \
+    { #name, group, key, offsetof(Tuning, name), FALSE, min, max }
+
+const TuningField tuning_fields[] = {
+    TF_INT(game_tick_ms,            "game",   "tick_ms",              1, 1000),
+    TF_DOUBLE(player_speed,         "player", "speed",                0.0, 100.0),
+    TF_DOUBLE(bullet_speed,         "player", "bullet_speed",         0.1, 100.0),
+    TF_DOUBLE(bullet_cooldown,      "player", "bullet_cooldown",      0.0, 10.0),
+    TF_DOUBLE(enemy_speed,          "enemy",  "speed",                0.0, 100.0),
+    TF_DOUBLE(enemy_spawn_interval, "enemy",  "spawn_interval",       0.001, 60.0),
+    TF_INT(max_enemies,             "limits", "max_enemies",          1, 100000),
+    TF_INT(max_bullets,             "limits", "max_bullets",          1, 100000),
+    TF_INT(world_width,             "world",  "width",                WINDOW_WIDTH, WORLD_MAX_SIZE),
+    TF_INT(world_height,            "world",  "height",               WINDOW_HEIGHT, WORLD_MAX_SIZE),
+    TF_DOUBLE(time_attack_limit,    "mode",   "time_attack_limit",    1.0, 3600.0),
+    TF_INT(conquest_kill_target,    "mode",   "conquest_kill_target", 0, 100000),
+    TF_INT(boss_hp,                 "mode",   "boss_hp",              1, 100000),
+};
+const int tuning_field_count = (int)G_N_ELEMENTS(tuning_fields);
+
+#undef TF_INT
+#undef TF_DOUBLE
+
+/* 有寫才讀; 格式錯誤保留原值, 超出範圍夾回範圍內 */
+static void keyfile_read_double(GKeyFile* kf, const char* group, const char* key,
+    double* out, double min, double max)
+{
+    GError* err = NULL;
+    if (!g_key_file_has_key(kf, group, key, NULL)) return;
+
+    double v = g_key_file_get_double(kf, group, key, &err);
+    if (err) {
+        g_print("[CFG] %s.%s: %s => keep %g\n", group, key, err->message, *out);
+        g_error_free(err);
+        return;
+    }
+    if (v < min || v > max) {
+        g_print("[CFG] %s.%s=%g out of [%g, %g] => clamp\n", group, key, v, min, max);
+        v = CLAMP(v, min, max);
+    }
+    *out = v;
+}
+
+static void keyfile_read_int(GKeyFile* kf, const char* group, const char* key,
+    int* out, int min, int max)
+{
+    GError* err = NULL;
+    if (!g_key_file_has_key(kf, group, key, NULL)) return;
+
+    int v = g_key_file_get_integer(kf, group, key, &err);
+    if (err) {
+        g_print("[CFG] %s.%s: %s => keep %d\n", group, key, err->message, *out);
+        g_error_free(err);
+        return;
+    }
+    if (v < min || v > max) {
+        g_print("[CFG] %s.%s=%d out of [%d, %d] => clamp\n", group, key, v, min, max);
+        v = CLAMP(v, min, max);
+    }
+    *out = v;
+}
+
+/* 解析 stellar.ini 到 t (t 需先填好預設值); 檔案讀不到回傳 FALSE */
+gboolean tuning_load(const char* path, Tuning* t, GError** error)
+{
+    gchar* data = NULL;
+    gsize len = 0;
+    if (!g_file_get_contents(path, &data, &len, error)) {
+        return FALSE;
+    }
+
+    /* Visual Studio / 記事本存檔會加 UTF-8 BOM, GKeyFile 不認得, 先跳過 */
+    const gchar* text = data;
+    if (len >= 3 && memcmp(text, "\xEF\xBB\xBF", 3) == 0) {
+        text += 3;
+        len -= 3;
+    }
+
+    GKeyFile* kf = g_key_file_new();
+    gboolean ok = g_key_file_load_from_data(kf, text, len, G_KEY_FILE_NONE, error);
+    g_free(data);
+    if (!ok) {
+        g_key_file_free(kf);
+        return FALSE;
+    }
+
+    for (int i = 0; i < tuning_field_count; i++) {
+        const TuningField* f = &tuning_fields[i];
+        char* p = (char*)t + f->offset;
+        if (f->is_int) {
+            keyfile_read_int(kf, f->group, f->key, (int*)p, (int)f->min, (int)f->max);
+        }
+        else {
+            keyfile_read_double(kf, f->group, f->key, (double*)p, f->min, f->max);
+        }
+    }
+
+    g_key_file_free(kf);
+    return TRUE;
+}
+
+/* === 初始化遊戲資料 === */
+void game_data_init(GameData* gd, const Tuning* tuning)
+{
+    gd->state = STATE_MENU;
+    gd->mode = MODE_DODGE; /* 預設 Dodge */
+
+    gd->width = CLAMP(tuning->world_width, WINDOW_WIDTH, WORLD_MAX_SIZE);
+    gd->height = CLAMP(tuning->world_height, WINDOW_HEIGHT, WORLD_MAX_SIZE);
+
+    gd->tuning = tuning;
+
+    gd->player_x = gd->width / 2.0;
+    gd->player_y = gd->height / 2.0;
+    camera_follow(gd);
+    gd->hp = HP_MAX;
+    gd->invincible = FALSE;
+    gd->invincible_timer = 0.0;
+
+    gd->up_pressed = FALSE;
+    gd->down_pressed = FALSE;
+    gd->left_pressed = FALSE;
+    gd->right_pressed = FALSE;
+    gd->space_pressed = FALSE;
+
+    gd->bullets = NULL;
+    gd->bullet_count = 0;
+    gd->bullet_capacity = 0;
+    gd->bullet_cooldown = 0.0;
+
+    gd->enemies = NULL;
+    gd->enemy_count = 0;
+    gd->enemy_capacity = 0;
+    gd->chunks = NULL;
+    gd->chunk_cols = 0;
+    gd->chunk_rows = 0;
+    gd->wheel = NULL;
+    gd->tick = 0;
+    gd->boss_count = 0;
+    gd->enemy_spawn_timer = 0.0;
+
+    gd->score = 0;
+
+    gd->dodge_score_timer = 0.0;
+    gd->time_left = tuning->time_attack_limit;
+    gd->time_attack_done = FALSE;
+    gd->enemies_killed = 0;
+    gd->boss_spawned = FALSE;
+    gd->event_count = 0;
+}
+
+/* === 重設一局的遊戲狀態 (不碰 UI) === */
+void game_reset(GameData* gd)
+{
+    gd->state = STATE_GAME;
+
+    /* 地圖大小只在開局時套用; 直接填 Tuning 的呼叫端也不能超過上限 */
+    gd->width = CLAMP(gd->tuning->world_width, WINDOW_WIDTH, WORLD_MAX_SIZE);
+    gd->height = CLAMP(gd->tuning->world_height, WINDOW_HEIGHT, WORLD_MAX_SIZE);
+
+    /* 清除敵人/子彈 */
+    entity_storage_reserve(gd);
+    gd->bullet_count = 0;
+    gd->enemy_count = 0;
+    chunks_clear(gd);
+    gd->boss_count = 0;
+    gd->tick = 0;
+
+    /* 重設玩家 / 分數 / 狀態 */
+    gd->hp = HP_MAX;
+    gd->invincible = FALSE;
+    gd->invincible_timer = 0.0;
+    gd->up_pressed = FALSE;
+    gd->down_pressed = FALSE;
+    gd->left_pressed = FALSE;
+    gd->right_pressed = FALSE;
+    gd->space_pressed = FALSE;
+
+    gd->bullet_cooldown = 0.0;
+    gd->enemy_spawn_timer = 0.0;
+
+    gd->player_x = gd->width / 2.0;
+    gd->player_y = gd->height / 2.0;
+    camera_follow(gd);
+    gd->score = 0;
+    gd->dodge_score_timer = 0.0;
+    gd->time_left = gd->tuning->time_attack_limit;
+    gd->time_attack_done = FALSE;
+    gd->enemies_killed = 0;
+    gd->boss_spawned = FALSE;
+    gd->event_count = 0;
+}
+
+/* === 結束一局 (畫面切換由呼叫端看 state 處理) === */
+void game_return_to_menu(GameData* gd)
+{
+    gd->state = STATE_MENU;
+
+    gd->bullet_count = 0;
+    gd->enemy_count = 0;
+    chunks_clear(gd);
+    gd->boss_count = 0;
+}
+
+/* 依目前的 max_enemies / max_bullets 配置陣列; 局中調整上限只能調低, 調高等下一局.
+ * 區塊格依地圖大小配置, 大小沒變就沿用 (各區塊的清單容量也保留) */
+static void entity_storage_reserve(GameData* gd)
+{
+    const Tuning* t = gd->tuning;
+    if (gd->bullet_capacity != t->max_bullets) {
+        gd->bullets = g_renew(Bullet, gd->bullets, t->max_bullets);
+        gd->bullet_capacity = t->max_bullets;
+    }
+    if (gd->enemy_capacity != t->max_enemies) {
+        gd->enemies = g_renew(Enemy, gd->enemies, t->max_enemies);
+        gd->enemy_capacity = t->max_enemies;
+    }
+
+    /* 以 gsize 計算格數; 地圖夾在 WORLD_MAX_SIZE 內, 總格數一定放得進 int */
+    gsize cols = ((gsize)gd->width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    gsize rows = ((gsize)gd->height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    if ((int)cols != gd->chunk_cols || (int)rows != gd->chunk_rows) {
+        for (int c = 0; c < gd->chunk_cols * gd->chunk_rows; c++) {
+            g_free(gd->chunks[c].items);
+        }
+        g_free(gd->chunks);
+        gd->chunks = g_new0(Chunk, cols * rows);
+        gd->chunk_cols = (int)cols;
+        gd->chunk_rows = (int)rows;
+    }
+    if (!gd->wheel) {
+        gd->wheel = g_new0(Chunk, WAKE_WHEEL_SIZE);
+    }
+}
+
+void game_data_free(GameData* gd)
+{
+    g_free(gd->bullets);
+    gd->bullets = NULL;
+    gd->bullet_count = gd->bullet_capacity = 0;
+    g_free(gd->enemies);
+    gd->enemies = NULL;
+    gd->enemy_count = gd->enemy_capacity = 0;
+    for (int c = 0; c < gd->chunk_cols * gd->chunk_rows; c++) {
+        g_free(gd->chunks[c].items);
+    }
+    g_free(gd->chunks);
+    gd->chunks = NULL;
+    gd->chunk_cols = gd->chunk_rows = 0;
+    if (gd->wheel) {
+        for (int w = 0; w < WAKE_WHEEL_SIZE; w++) {
+            g_free(gd->wheel[w].items);
+        }
+        g_free(gd->wheel);
+        gd->wheel = NULL;
+    }
+    gd->boss_count = 0;
+}
+
+/* === 鏡頭 / 區塊 === */
+/* 鏡頭以玩家為中心, 不超出地圖 */
+static void camera_follow(GameData* gd)
+{
+    double max_x = gd->width - WINDOW_WIDTH;
+    double max_y = gd->height - WINDOW_HEIGHT;
+    gd->cam_x = CLAMP(gd->player_x - WINDOW_WIDTH / 2.0, 0.0, MAX(max_x, 0.0));
+    gd->cam_y = CLAMP(gd->player_y - WINDOW_HEIGHT / 2.0, 0.0, MAX(max_y, 0.0));
+}
+
+static int chunk_of(const GameData* gd, double x, double y)
+{
+    int cx = CLAMP((int)(x / CHUNK_SIZE), 0, gd->chunk_cols - 1);
+    int cy = CLAMP((int)(y / CHUNK_SIZE), 0, gd->chunk_rows - 1);
+    return cy * gd->chunk_cols + cx;
+}
+
+void game_chunk_range(const GameData* gd, double x0, double y0, double x1, double y1,
+    int* cx0, int* cy0, int* cx1, int* cy1)
+{
+    /* 尚未開局: 空範圍 */
+    if (gd->chunk_cols == 0 || gd->chunk_rows == 0) {
+        *cx0 = *cy0 = 0;
+        *cx1 = *cy1 = -1;
+        return;
+    }
+    *cx0 = CLAMP((int)floor(x0 / CHUNK_SIZE), 0, gd->chunk_cols - 1);
+    *cy0 = CLAMP((int)floor(y0 / CHUNK_SIZE), 0, gd->chunk_rows - 1);
+    *cx1 = CLAMP((int)floor(x1 / CHUNK_SIZE), 0, gd->chunk_cols - 1);
+    *cy1 = CLAMP((int)floor(y1 / CHUNK_SIZE), 0, gd->chunk_rows - 1);
+}
+
+/* 區塊與時間輪共用的索引清單: 加到尾端回傳位置; 移除以最後一筆補位,
+ * 回傳補上來的索引 (沒有補位則 -1), 由呼叫端更新它記錄的位置 */
+static int index_list_push(Chunk* ch, int idx)
+{
+    if (ch->count == ch->capacity) {
+        ch->capacity = ch->capacity ? ch->capacity * 2 : 8;
+        ch->items = g_renew(int, ch->items, ch->capacity);
+    }
+    ch->items[ch->count] = idx;
+    return ch->count++;
+}
+
+static int index_list_remove_at(Chunk* ch, int slot)
+{
+    int last = ch->items[--ch->count];
+    if (slot == ch->count) return -1;
+    ch->items[slot] = last;
+    return last;
+}
+
+static void chunk_push(GameData* gd, int c, int idx)
+{
+    Enemy* e = &gd->enemies[idx];
+    e->chunk = c;
+    e->slot = index_list_push(&gd->chunks[c], idx);
+}
+
+static void chunk_remove_at(GameData* gd, int c, int slot)
+{
+    int moved = index_list_remove_at(&gd->chunks[c], slot);
+    if (moved >= 0) gd->enemies[moved].slot = slot;
+}
+
+static void chunks_clear(GameData* gd)
+{
+    for (int c = 0; c < gd->chunk_cols * gd->chunk_rows; c++) {
+        gd->chunks[c].count = 0;
+    }
+    /* 尚未開局時還沒配置 */
+    for (int w = 0; gd->wheel && w < WAKE_WHEEL_SIZE; w++) {
+        gd->wheel[w].count = 0;
+    }
+}
+
+/* === 時間輪 === */
+/* 從 e->tick 的位置起算, 直線移動多少 tick 後會跨出目前區塊 (含離開地圖).
+ * 最外圈的區塊一路延伸到地圖邊界 (chunk_of 會夾住) */
+static guint32 enemy_ticks_to_exit(const GameData* gd, const Enemy* e)
+{
+    int cx = e->chunk % gd->chunk_cols;
+    int cy = e->chunk / gd->chunk_cols;
+    double x0 = cx * (double)CHUNK_SIZE;
+    double y0 = cy * (double)CHUNK_SIZE;
+    double x1 = cx == gd->chunk_cols - 1 ? gd->width : x0 + CHUNK_SIZE;
+    double y1 = cy == gd->chunk_rows - 1 ? gd->height : y0 + CHUNK_SIZE;
+    double vx = e->dx * e->speed;
+    double vy = e->dy * e->speed;
+
+    double t = WAKE_WHEEL_SIZE;
+    if (vx > 0) t = MIN(t, (x1 - e->x) / vx);
+    if (vx < 0) t = MIN(t, (x0 - e->x) / vx);
+    if (vy > 0) t = MIN(t, (y1 - e->y) / vy);
+    if (vy < 0) t = MIN(t, (y0 - e->y) / vy);
+
+    /* 越過邊界的第一個 tick; 太遠的先排到最後一格, 醒來再重排 */
+    double n = floor(MAX(t, 0.0)) + 1.0;
+    return (guint32)MIN(n, (double)(WAKE_WHEEL_SIZE - 1));
+}
+
+/* 依目前區塊排下一次醒來的 tick. e->tick 不晚於 gd->tick, 所以 wake 不會早於
+ * 目前 tick; 剛生成 (tick 落後一格) 的可能就排在本 tick, 由稍後的 update_wheel 處理 */
+static void wheel_schedule(GameData* gd, int idx)
+{
+    Enemy* e = &gd->enemies[idx];
+    guint32 wake = e->tick + enemy_ticks_to_exit(gd, e);
+    e->wake = wake;
+    e->wake_slot = index_list_push(&gd->wheel[wake & (WAKE_WHEEL_SIZE - 1)], idx);
+}
+
+static void wheel_cancel(GameData* gd, int idx)
+{
+    Enemy* e = &gd->enemies[idx];
+    int moved = index_list_remove_at(&gd->wheel[e->wake & (WAKE_WHEEL_SIZE - 1)], e->wake_slot);
+    if (moved >= 0) gd->enemies[moved].wake_slot = e->wake_slot;
+}
+
+/* 取一個新敵機位置; 呼叫端填好座標後再 chunk_push / wheel_schedule */
+static Enemy* enemy_add(GameData* gd)
+{
+    return &gd->enemies[gd->enemy_count++];
+}
+
+/* 從區塊 / 時間輪與 enemies 移除; enemies 以最後一筆補位, 並改寫它在兩邊清單中的索引 */
+static void enemy_remove(GameData* gd, int idx)
+{
+    Enemy* e = &gd->enemies[idx];
+    chunk_remove_at(gd, e->chunk, e->slot);
+    wheel_cancel(gd, idx);
+
+    int last = --gd->enemy_count;
+    if (idx != last) {
+        gd->enemies[idx] = gd->enemies[last];
+        e = &gd->enemies[idx];
+        gd->chunks[e->chunk].items[e->slot] = idx;
+        gd->wheel[e->wake & (WAKE_WHEEL_SIZE - 1)].items[e->wake_slot] = idx;
+    }
+}
+
+/* 位置跨區塊時搬到新區塊; 有搬回傳 TRUE (原 slot 已換成別隻) */
+static gboolean enemy_rebucket(GameData* gd, int idx)
+{
+    Enemy* e = &gd->enemies[idx];
+    int c = chunk_of(gd, e->x, e->y);
+    if (c == e->chunk) return FALSE;
+
+    chunk_remove_at(gd, e->chunk, e->slot);
+    chunk_push(gd, c, idx);
+    return TRUE;
+}
+
+/* 補上從 e->tick 到目前 tick 的直線移動 */
+static void enemy_catch_up(GameData* gd, Enemy* e)
+{
+    double steps = (double)(guint32)(gd->tick - e->tick);
+    e->x += e->dx * e->speed * steps;
+    e->y += e->dy * e->speed * steps;
+    e->tick = gd->tick;
+}
+
+static gboolean enemy_in_world(const GameData* gd, const Enemy* e)
+{
+    return !(e->x<0 || e->x>gd->width || e->y<0 || e->y>gd->height);
+}
+
+/* 時間輪: 處理本 tick 到期的敵機 (只有移動 / 出界 / 換區塊, 沒有碰撞).
+ * 鏡頭附近的敵機已逐 tick 更新過, 這裡只幫它重排; 遠方的補上落後的移動量.
+ * 每次取這一格的最後一筆, 移除時不會搬動同格的其他敵機;
+ * 重排一定排到之後的 tick, 不會回到這一格 */
+static void update_wheel(GameData* gd)
+{
+    Chunk* due = &gd->wheel[gd->tick & (WAKE_WHEEL_SIZE - 1)];
+    while (due->count > 0) {
+        int idx = due->items[due->count - 1];
+        Enemy* e = &gd->enemies[idx];
+
+        enemy_catch_up(gd, e);
+        if (!enemy_in_world(gd, e)) {
+            enemy_remove(gd, idx);
+            continue;
+        }
+        wheel_cancel(gd, idx);
+        enemy_rebucket(gd, idx);
+        wheel_schedule(gd, idx);
+    }
+}
+
+/* === 工具 === */
+static double rand_range(double min, double max)
+{
+    return min + (double)rand() / (double)RAND_MAX * (max - min);
+}
+
+static gboolean circle_collide(double x1, double y1, double r1,
+    double x2, double y2, double r2)
+{
+    double dx = x2 - x1;
+    double dy = y2 - y1;
+    double dist2 = dx * dx + dy * dy;
+    double rr = (r1 + r2) * (r1 + r2);
+    return(dist2 <= rr);
+}
+
+/* 第一顆打中 (x, y, r) 的子彈索引, 沒有則 -1 */
+static int bullet_find_hit(const Bullet* bullets, int count, double x, double y, double r)
+{
+    for (int i = 0; i < count; i++) {
+        if (circle_collide(bullets[i].x, bullets[i].y, BULLET_SIZE, x, y, r)) return i;
+    }
+    return -1;
+}
+
+/* 建立子彈/敵機 (寫入呼叫端提供的陣列位置) */
+static void bullet_init(Bullet* b, double x, double y, double speed)
+{
+    b->x = x; b->y = y;
+    b->speed = speed;
+}
+
+/* 從鏡頭視野的邊緣出現, 朝視野內隨機一點前進 */
+static void enemy_init_normal(GameData* gd, Enemy* e, double speed)
+{
+    double x0 = gd->cam_x, y0 = gd->cam_y;
+    double w = WINDOW_WIDTH, h = WINDOW_HEIGHT;
+    e->boss_hp = 0;
+
+    int edge = rand() % 4;
+    if (edge == 0) {
+        e->x = x0 + rand_range(0, w); e->y = y0;
+    }
+    else if (edge == 1) {
+        e->x = x0 + rand_range(0, w); e->y = y0 + h;
+    }
+    else if (edge == 2) {
+        e->x = x0; e->y = y0 + rand_range(0, h);
+    }
+    else {
+        e->x = x0 + w; e->y = y0 + rand_range(0, h);
+    }
+
+    double tx = x0 + rand_range(0, w), ty = y0 + rand_range(0, h);
+    double dx = tx - e->x, dy = ty - e->y;
+    double length = sqrt(dx * dx + dy * dy);
+    if (length > 0) { e->dx = dx / length; e->dy = dy / length; }
+    else { e->dx = 0; e->dy = 1; }
+    e->speed = speed;
+
+    /* 生成的這個 tick 就要移動 (與原本逐一更新的順序相同) */
+    e->tick = gd->tick - 1;
+}
+
+static void enemy_init_boss(GameData* gd, Enemy* e)
+{
+    e->boss_hp = gd->tuning->boss_hp;
+
+    double x0 = gd->cam_x, y0 = gd->cam_y;
+    double w = WINDOW_WIDTH, h = WINDOW_HEIGHT;
+    int edge = rand() % 4;
+    if (edge == 0) {
+        e->x = x0 + rand_range(0, w); e->y = y0;
+    }
+    else if (edge == 1) {
+        e->x = x0 + rand_range(0, w); e->y = y0 + h;
+    }
+    else if (edge == 2) {
+        e->x = x0; e->y = y0 + rand_range(0, h);
+    }
+    else {
+        e->x = x0 + w; e->y = y0 + rand_range(0, h);
+    }
+
+    double tx = gd->player_x - e->x;
+    double ty = gd->player_y - e->y;
+    double length = sqrt(tx * tx + ty * ty);
+    if (length > 0) { e->dx = tx / length; e->dy = ty / length; }
+    else { e->dx = 0; e->dy = 1; }
+    e->speed = gd->tuning->enemy_speed * BOSS_SPEED_RATIO;
+}
+
+static void game_emit(GameData* gd, GameEventType ev)
+{
+    if (gd->event_count < MAX_TICK_EVENTS) {
+        gd->events[gd->event_count++] = (guint8)ev;
+    }
+}
+
+/* 是否能開火 (Dodge模式不能) */
+static gboolean can_player_fire(GameData* gd)
+{
+    return (gd->mode != MODE_DODGE);
+}
+
+/* 模式處理 */
+static void update_mode_specific(GameData* gd, double dt)
+{
+    switch (gd->mode) {
+    case MODE_DODGE:
+        /* 每秒+10分 (非無敵) */
+        gd->dodge_score_timer += dt;
+        while (gd->dodge_score_timer >= 1.0) {
+            gd->dodge_score_timer -= 1.0;
+            if (!gd->invincible && gd->hp > 0) {
+                gd->score += DODGE_SCORE_PER_SEC;
+            }
+        }
+        break;
+
+    case MODE_TIME_ATTACK:
+        /* 倒數 */
+        if (!gd->time_attack_done) {
+            gd->time_left -= dt;
+            if (gd->time_left <= 0) {
+                gd->time_left = 0;
+                gd->time_attack_done = TRUE;
+            }
+        }
+        if (gd->time_attack_done || gd->hp <= 0) {
+            /* 時間到 或 HP=0 => 結束 */
+            game_return_to_menu(gd);
+        }
+        break;
+
+    case MODE_CONQUEST:
+        /* 擊殺一定數量 => 召喚Boss */
+        if (!gd->boss_spawned && gd->enemies_killed >= gd->tuning->conquest_kill_target) {
+            gd->boss_spawned = TRUE;
+            if (gd->boss_count < MAX_BOSSES) {
+                enemy_init_boss(gd, &gd->bosses[gd->boss_count++]);
+                game_emit(gd, GAME_EVENT_BOSS_SPAWN);
+            }
+        }
+        if (gd->hp <= 0) {
+            /* HP=0 => 結束 */
+            game_return_to_menu(gd);
+        }
+        break;
+    }
+}
+
+/* === 推進一個 tick ===
+ * 普通敵機只有鏡頭附近的區塊逐 tick 更新 / 碰撞, 遠方的跨區塊時由 update_wheel 補進度.
+ * 結束時 state 會變回 STATE_MENU. */
+void game_step(GameData* gd, double dt)
+{
+    const Tuning* t = gd->tuning;
+    gboolean can_fire = can_player_fire(gd);
+
+    gd->tick++;
+    gd->event_count = 0;
+
+    if (gd->hp > 0) {
+        /* 玩家移動... */
+        double dx = 0, dy = 0;
+        if (gd->up_pressed)   dy -= 1;
+        if (gd->down_pressed) dy += 1;
+        if (gd->left_pressed) dx -= 1;
+        if (gd->right_pressed)dx += 1;
+        double length = sqrt(dx * dx + dy * dy);
+        if (length > 0) { dx /= length; dy /= length; }
+        gd->player_x += dx * t->player_speed;
+        gd->player_y += dy * t->player_speed;
+
+        /* 邊界檢查 */
+        if (gd->player_x < 0) gd->player_x = 0;
+        if (gd->player_x > gd->width)  gd->player_x = gd->width;
+        if (gd->player_y < 0) gd->player_y = 0;
+        if (gd->player_y > gd->height) gd->player_y = gd->height;
+
+        camera_follow(gd);
+
+        /* 無敵時間 */
+        if (gd->invincible) {
+            gd->invincible_timer -= dt;
+            if (gd->invincible_timer <= 0) {
+                gd->invincible = FALSE;
+                gd->invincible_timer = 0;
+            }
+        }
+
+        if (can_fire) {
+            /* 開火 */
+            if (gd->space_pressed && gd->bullet_cooldown <= 0 &&
+                gd->bullet_count < gd->bullet_capacity &&
+                gd->bullet_count < t->max_bullets) {
+                bullet_init(&gd->bullets[gd->bullet_count++],
+                    gd->player_x, gd->player_y, t->bullet_speed);
+                gd->bullet_cooldown = t->bullet_cooldown;
+                game_emit(gd, GAME_EVENT_SHOOT);
+            }
+            else {
+                gd->bullet_cooldown -= dt;
+                if (gd->bullet_cooldown < 0) gd->bullet_cooldown = 0;
+            }
+
+            /* 子彈移動 & 超出畫面 (鏡頭上緣) 移除 */
+            Bullet* bullets = gd->bullets;
+            int nb = gd->bullet_count;
+            for (int i = 0; i < nb; ) {
+                bullets[i].y -= bullets[i].speed;
+                if (bullets[i].y < gd->cam_y) {
+                    bullets[i] = bullets[--nb];
+                    continue;
+                }
+                i++;
+            }
+            gd->bullet_count = nb;
+        }
+
+        /* 敵機生成 */
+        gd->enemy_spawn_timer += dt;
+        if (gd->enemy_spawn_timer >= t->enemy_spawn_interval) {
+            gd->enemy_spawn_timer = 0;
+            if (gd->enemy_count < gd->enemy_capacity && gd->enemy_count < t->max_enemies) {
+                Enemy* e = enemy_add(gd);
+                enemy_init_normal(gd, e, t->enemy_speed);
+                chunk_push(gd, chunk_of(gd, e->x, e->y), gd->enemy_count - 1);
+                wheel_schedule(gd, gd->enemy_count - 1);
+            }
+        }
+
+        /* end_game: 此迴圈執行完後再判斷是否要回主選單 */
+        gboolean end_game = FALSE;
+
+        /* 鏡頭附近的區塊 */
+        double margin = ACTIVE_CHUNK_MARGIN * CHUNK_SIZE;
+        int cx0, cy0, cx1, cy1;
+        game_chunk_range(gd, gd->cam_x - margin, gd->cam_y - margin,
+            gd->cam_x + WINDOW_WIDTH + margin, gd->cam_y + WINDOW_HEIGHT + margin,
+            &cx0, &cy0, &cx1, &cy1);
+
+        /* 普通敵機更新 / 碰撞. 移除或換區塊時以最後一筆補位, 補上來的這筆下一輪處理;
+         * 搬進後面區塊的敵機 tick 已是最新, 不會重複更新 */
+        for (int cy = cy0; cy <= cy1 && !end_game; cy++) {
+            for (int cx = cx0; cx <= cx1 && !end_game; cx++) {
+                Chunk* ch = &gd->chunks[cy * gd->chunk_cols + cx];
+                for (int i = 0; i < ch->count; ) {
+                    int idx = ch->items[i];
+                    Enemy* e = &gd->enemies[idx];
+                    if (e->tick == gd->tick) { i++; continue; }
+
+                    /* 剛進入範圍的區塊會一次補上落後的 tick */
+                    enemy_catch_up(gd, e);
+
+                    /* 出界 */
+                    if (!enemy_in_world(gd, e)) {
+                        enemy_remove(gd, idx);
+                        continue;
+                    }
+
+                    /* 與玩家碰撞 */
+                    if (!gd->invincible &&
+                        circle_collide(gd->player_x, gd->player_y, PLAYER_SIZE, e->x, e->y, ENEMY_SIZE)) {
+                        gd->hp--;
+                        game_emit(gd, GAME_EVENT_HIT);
+                        if (gd->hp <= 0) {
+                            end_game = TRUE;
+                            break;
+                        }
+                        gd->invincible = TRUE;
+                        gd->invincible_timer = INVINCIBLE_TIME;
+                    }
+
+                    /* 子彈打敵機: 一發即毀 */
+                    if (can_fire) {
+                        int hit = bullet_find_hit(gd->bullets, gd->bullet_count, e->x, e->y, ENEMY_SIZE);
+                        if (hit >= 0) {
+                            gd->bullets[hit] = gd->bullets[--gd->bullet_count];
+                            gd->score += ENEMY_SCORE;
+                            if (gd->mode == MODE_CONQUEST) gd->enemies_killed++;
+                            game_emit(gd, GAME_EVENT_KILL);
+                            enemy_remove(gd, idx);
+                            continue;
+                        }
+                    }
+
+                    if (enemy_rebucket(gd, idx)) continue;
+                    i++;
+                }
+            }
+        }
+
+        /* 本 tick 跨區塊的敵機 (遠方的在這裡補進度) */
+        if (!end_game) {
+            update_wheel(gd);
+        }
+
+        /* Boss 更新 / 碰撞 (只有 Conquest 會生成) */
+        if (!end_game) {
+            double r = ENEMY_SIZE * BOSS_SIZE_RATIO;
+            for (int i = 0; i < gd->boss_count; ) {
+                Enemy* e = &gd->bosses[i];
+
+                /* Boss 追玩家 */
+                double tx = gd->player_x - e->x;
+                double ty = gd->player_y - e->y;
+                double length2 = sqrt(tx * tx + ty * ty);
+                if (length2 > 0) { tx /= length2; ty /= length2; }
+                e->dx = tx; e->dy = ty;
+
+                e->x += e->dx * e->speed;
+                e->y += e->dy * e->speed;
+
+                /* 出界 */
+                if (!enemy_in_world(gd, e)) {
+                    gd->bosses[i] = gd->bosses[--gd->boss_count];
+                    continue;
+                }
+
+                /* 與玩家碰撞 */
+                if (!gd->invincible &&
+                    circle_collide(gd->player_x, gd->player_y, PLAYER_SIZE, e->x, e->y, r)) {
+                    gd->hp--;
+                    game_emit(gd, GAME_EVENT_HIT);
+                    if (gd->hp <= 0) {
+                        end_game = TRUE;
+                        break;
+                    }
+                    gd->invincible = TRUE;
+                    gd->invincible_timer = INVINCIBLE_TIME;
+                }
+
+                /* 子彈打 Boss: 每發扣一血, Boss 死 => 結束 */
+                if (can_fire) {
+                    int hit;
+                    while ((hit = bullet_find_hit(gd->bullets, gd->bullet_count, e->x, e->y, r)) >= 0) {
+                        gd->bullets[hit] = gd->bullets[--gd->bullet_count];
+                        e->boss_hp--;
+                        if (e->boss_hp <= 0) {
+                            gd->score += BOSS_SCORE;
+                            game_emit(gd, GAME_EVENT_BOSS_KILL);
+                            end_game = TRUE;
+                            break;
+                        }
+                    }
+                    if (end_game) {
+                        gd->bosses[i] = gd->bosses[--gd->boss_count];
+                        break;
+                    }
+                }
+                i++;
+            }
+        }
+
+        if (end_game) {
+            game_return_to_menu(gd);
+            return;
+        }
+    }
+
+    /* 模式專用更新 */
+    update_mode_specific(gd, dt);
+}
+
+/* wake 記的是絕對 tick, 補算座標不影響排程, 不必重排 */
+void game_sync_positions(GameData* gd)
+{
+    for (int i = 0; i < gd->enemy_count; i++) {
+        enemy_catch_up(gd, &gd->enemies[i]);
+    }
+}
+
+/* === --bench: 各模式每 tick 耗時 ===
+ * 固定亂數種子與輸入, 每次跑同樣的局面; checksum 用來比對改版前後行為是否一致. */
+#define BENCH_TICKS   20000
+#define BENCH_REPEAT  5
+#define BENCH_SEED    12345
+
+/* 大地圖: 區塊密度固定, 地圖越大總數越多 */
+#define BENCH_WORLD_TICKS    2000
+#define BENCH_WORLD_DENSITY  16   /* 每個區塊的敵機數 */
+
+/* 重設一局並讓玩家不會死 / 不會時間到, 保持滿場敵機 */
+static void bench_reset(GameData* gd)
+{
+    game_reset(gd);
+    gd->hp = 1 << 30;
+    gd->time_left = 1e9;
+    gd->space_pressed = TRUE;
+}
+
+/* 跑一次固定局面, 回傳平均每 tick 微秒數 */
+static double bench_run(GameData* gd, GameMode mode, long long* checksum)
+{
+    double dt = gd->tuning->game_tick_ms / 1000.0;
+    long long sum = 0;
+
+    srand(BENCH_SEED);
+    gd->mode = mode;
+    bench_reset(gd);
+
+    gint64 t0 = g_get_monotonic_time();
+    for (int i = 0; i < BENCH_TICKS; i++) {
+        /* 左右來回, 讓玩家掃過整個畫面 */
+        gboolean left = (i / 120) % 2;
+        gd->left_pressed = left;
+        gd->right_pressed = !left;
+
+        game_step(gd, dt);
+
+        /* Boss 被擊倒 => 回選單, 重開一局繼續 */
+        if (gd->state != STATE_GAME) {
+            sum += gd->score;
+            bench_reset(gd);
+        }
+    }
+    double us = (double)(g_get_monotonic_time() - t0) / BENCH_TICKS;
+
+    *checksum = sum + gd->score + gd->enemy_count + gd->bullet_count;
+    return us;
+}
+
+/* 在整張地圖上平均撒 count 隻敵機 */
+static void bench_populate(GameData* gd, int count)
+{
+    for (int i = 0; i < count && gd->enemy_count < gd->enemy_capacity; i++) {
+        Enemy* e = enemy_add(gd);
+        e->boss_hp = 0;
+        e->x = rand_range(0, gd->width);
+        e->y = rand_range(0, gd->height);
+        double a = rand_range(0, 2 * G_PI);
+        e->dx = cos(a);
+        e->dy = sin(a);
+        e->speed = gd->tuning->enemy_speed;
+        e->tick = gd->tick;
+        chunk_push(gd, chunk_of(gd, e->x, e->y), gd->enemy_count - 1);
+        wheel_schedule(gd, gd->enemy_count - 1);
+    }
+}
+
+/* 地圖放大 (敵機總數跟著放大) 時每 tick 的耗時 */
+static void bench_world(GameData* gd, Tuning* bench)
+{
+    static const int scales[] = { 1, 2, 4, 8, 16 };
+    double dt = bench->game_tick_ms / 1000.0;
+
+    g_print("[BENCH] world scaling, %d ticks, %d enemies per chunk\n",
+        BENCH_WORLD_TICKS, BENCH_WORLD_DENSITY);
+    g_print("[BENCH] %-12s %8s %8s %10s\n", "world", "chunks", "enemies", "us/tick");
+    for (size_t s = 0; s < G_N_ELEMENTS(scales); s++) {
+        bench->world_width = WINDOW_WIDTH * scales[s];
+        bench->world_height = WINDOW_HEIGHT * scales[s];
+        int chunks = ((bench->world_width + CHUNK_SIZE - 1) / CHUNK_SIZE) *
+            ((bench->world_height + CHUNK_SIZE - 1) / CHUNK_SIZE);
+        bench->max_enemies = chunks * BENCH_WORLD_DENSITY + 1024;
+
+        double best = 0.0;
+        int enemies = 0;
+        for (int rep = 0; rep < BENCH_REPEAT; rep++) {
+            srand(BENCH_SEED);
+            gd->mode = MODE_TIME_ATTACK;
+            bench_reset(gd);
+            bench_populate(gd, chunks * BENCH_WORLD_DENSITY);
+            enemies = gd->enemy_count;
+
+            gint64 t0 = g_get_monotonic_time();
+            for (int i = 0; i < BENCH_WORLD_TICKS; i++) {
+                gboolean left = (i / 120) % 2;
+                gd->left_pressed = left;
+                gd->right_pressed = !left;
+                game_step(gd, dt);
+            }
+            double us = (double)(g_get_monotonic_time() - t0) / BENCH_WORLD_TICKS;
+            if (rep == 0 || us < best) best = us;
+        }
+
+        char world[32];
+        snprintf(world, sizeof(world), "%dx%d", bench->world_width, bench->world_height);
+        g_print("[BENCH] %-12s %8d %8d %10.3f\n", world, chunks, enemies, best);
+    }
+}
+
+void game_run_benchmark(GameData* gd)
+{
+    static const char* mode_names[] = { "Dodge", "Time Attack", "Conquest" };
+
+    /* 高密度: 每 tick 生一隻敵機, 子彈無冷卻 */
+    const Tuning* saved = gd->tuning;
+    Tuning bench = *saved;
+    bench.enemy_spawn_interval = 0.001;
+    bench.bullet_cooldown = 0.0;
+    bench.max_enemies = 4096;
+    bench.max_bullets = 1024;
+    gd->tuning = &bench;
+
+    g_print("[BENCH] %d ticks x best of %d, seed %d\n", BENCH_TICKS, BENCH_REPEAT, BENCH_SEED);
+    g_print("[BENCH] %-12s %10s %12s\n", "mode", "us/tick", "checksum");
+    for (int m = MODE_DODGE; m <= MODE_CONQUEST; m++) {
+        long long sum = 0;
+        double best = 0.0;
+        for (int rep = 0; rep < BENCH_REPEAT; rep++) {
+            double us = bench_run(gd, (GameMode)m, &sum);
+            if (rep == 0 || us < best) best = us;
+        }
+        g_print("[BENCH] %-12s %10.3f %12lld\n", mode_names[m], best, sum);
+    }
+
+    /* 大地圖: 敵機慢一點, 跑完時大部分還在地圖上 */
+    bench.enemy_speed = 0.5;
+    bench.enemy_spawn_interval = ENEMY_SPAWN_INTERVAL;
+    bench_world(gd, &bench);
+
+    gd->tuning = saved;
+    gd->state = STATE_MENU;
+    gd->mode = MODE_DODGE;
+}
+
@@ -0,0 +1,223 @@
+﻿#pragma once
+/* === 遊戲邏輯 (不依賴 GTK) ===
+ * main.c 的 GTK 介面、--bench 與 Python 擴充模組 (python/) 共用這一份.
+ * 只用到 GLib; 繪圖、鍵盤、計時器都由呼叫端負責. */
+
+#include <glib.h>
+
+/* 標註 [ini] 的常數只是預設值, 執行期以 stellar.ini 為準 (見 Tuning) */
+
+/* === 場地大小 & 更新頻率 === */
+#define WINDOW_WIDTH   800        /* 鏡頭視野 */
+#define WINDOW_HEIGHT  600
+#define GAME_TICK_MS   16         /* [ini] */
+
+/* === 大地圖 / 區塊 ===
+ * 普通敵機依位置分進 CHUNK_SIZE 見方的區塊. 鏡頭附近 (視野外再多
+ * ACTIVE_CHUNK_MARGIN 圈) 每 tick 完整更新 / 碰撞; 遠方的敵機只做直線
+ * 移動, 平時不動它, 依速度算出會跨出目前區塊的 tick, 排進時間輪
+ * (WAKE_WHEEL_SIZE 格, 以 tick 取餘數), 到點才一次補齊移動量並換區塊.
+ * 所以區塊清單最多只落後實際位置一個 tick, 敵機跨進鏡頭附近時一定已在
+ * 對應的區塊裡. 遠方敵機的座標本身可能落後到 WAKE_WHEEL_SIZE-1 個 tick,
+ * 要讀整張地圖的位置前先呼叫 game_sync_positions. */
+#define WORLD_WIDTH    4800       /* [ini] */
+#define WORLD_HEIGHT   3600       /* [ini] */
+#define WORLD_MAX_SIZE 1000000    /* 地圖每邊上限 (區塊格數要放得進 int) */
+#define CHUNK_SIZE     400
+#define ACTIVE_CHUNK_MARGIN 1
+#define WAKE_WHEEL_SIZE 256       /* 2 的冪; 排程最遠 WAKE_WHEEL_SIZE-1 tick */
+
+/* 玩家/敵人/子彈相關常數 (與您先前相同) */
+#define PLAYER_SPEED   5.0        /* [ini] */
+#define PLAYER_SIZE    20.0
+#define INVINCIBLE_TIME 1.0
+#define HP_MAX         3
+
+#define BULLET_SPEED   8.0        /* [ini] */
+#define BULLET_SIZE    5
+#define BULLET_COOLDOWN 0.2       /* [ini] */
+
+#define ENEMY_SIZE     15
+#define ENEMY_SPEED    2.0        /* [ini] */
+#define ENEMY_SCORE    100
+#define ENEMY_SPAWN_INTERVAL 1.0  /* [ini] */
+
+/* 模式相關常數 */
+#define DODGE_SCORE_PER_SEC  10
+#define TIME_ATTACK_LIMIT    60.0 /* [ini] */
+#define CONQUEST_KILL_TARGET 10   /* [ini] */
+#define BOSS_SIZE_RATIO      5.0
+#define BOSS_SPEED_RATIO     0.75
+#define BOSS_HP              5    /* [ini] */
+#define BOSS_SCORE           500
+
+/* 同時存在的實體上限 */
+#define MAX_ENEMIES          256  /* [ini] */
+#define MAX_BULLETS          64   /* [ini] */
+#define MAX_BOSSES           4
+#define MAX_TICK_EVENTS      32
+
+/* 遊戲狀態 / 模式列舉 */
+typedef enum {
+    STATE_MENU,
+    STATE_GAME
+} GameState;
+
+typedef enum {
+    MODE_DODGE,
+    MODE_TIME_ATTACK,
+    MODE_CONQUEST
+} GameMode;
+
+/* 遊戲事件 (音效等表現層用); 每個 tick 開始時清空 */
+typedef enum {
+    GAME_EVENT_SHOOT,
+    GAME_EVENT_HIT,         /* 玩家被撞 */
+    GAME_EVENT_KILL,        /* 普通敵機被擊落 */
+    GAME_EVENT_BOSS_SPAWN,
+    GAME_EVENT_BOSS_KILL
+} GameEventType;
+
+/* 執行期參數: 啟動時由 stellar.ini 解析, 檔案變動時熱重載.
+ * 生效中的一份只讀, 重載時整份換掉; 檔案沒寫到的欄位沿用上方 #define. */
+typedef struct {
+    int    game_tick_ms;
+    double player_speed;
+    double bullet_speed;
+    double bullet_cooldown;
+    double enemy_speed;
+    double enemy_spawn_interval;
+    int    boss_hp;
+    double time_attack_limit;
+    int    conquest_kill_target;
+    int    max_enemies;
+    int    max_bullets;
+    int    world_width;
+    int    world_height;
+} Tuning;
+
+/* Tuning 欄位表: stellar.ini 的 [group] key 與允許範圍.
+ * ini 與 Python 關鍵字參數共用同一份, 兩邊的範圍不會各改各的 */
+typedef struct {
+    const char* name;       /* 欄位名 (Python 關鍵字) */
+    const char* group;      /* stellar.ini 的 [group] */
+    const char* key;
+    size_t offset;          /* 在 Tuning 中的位移 */
+    gboolean is_int;
+    double min, max;
+} TuningField;
+
+extern const TuningField tuning_fields[];
+extern const int tuning_field_count;
+
+/* 子彈 / 敵機資料結構 */
+typedef struct {
+    double x, y;
+    double speed;
+} Bullet;
+
+/* 普通敵機與 Boss 共用; Boss 另外放在 gd->bosses, boss_hp 只對 Boss 有意義.
+ * tick 以後的欄位只對普通敵機有意義 */
+typedef struct {
+    double x, y;
+    double dx, dy;
+    double speed;
+    int boss_hp;
+    guint32 tick;   /* 位置已更新到哪個 tick */
+    int chunk;      /* 所在區塊 */
+    int slot;       /* 在該區塊清單中的位置 */
+    guint32 wake;   /* 預計跨出區塊的 tick */
+    int wake_slot;  /* 在時間輪那一格清單中的位置 */
+} Enemy;
+
+/* 區塊 / 時間輪的一格: 普通敵機在 gd->enemies 的索引 */
+typedef struct {
+    int* items;
+    int count;
+    int capacity;
+} Chunk;
+
+/* === 遊戲資料 (一局的模擬狀態) === */
+typedef struct {
+    GameState state;
+    GameMode  mode;
+
+    /* 地圖大小 (開局時取自 tuning, 局中不變) */
+    int width;
+    int height;
+
+    /* 鏡頭左上角 (地圖座標), 視野 WINDOW_WIDTH x WINDOW_HEIGHT, 跟著玩家 */
+    double cam_x, cam_y;
+
+    /* 執行期參數 (只讀, 由呼叫端擁有) */
+    const Tuning* tuning;
+
+    /* 玩家 */
+    double player_x, player_y;
+    int hp;
+    gboolean invincible;
+    double invincible_timer;
+    gboolean up_pressed;
+    gboolean down_pressed;
+    gboolean left_pressed;
+    gboolean right_pressed;
+    gboolean space_pressed;
+
+    /* 子彈 (連續陣列, 移除時以最後一筆補位) */
+    Bullet* bullets;
+    int bullet_count;
+    int bullet_capacity;
+    double bullet_cooldown;
+
+    /* 敵機: 普通敵機與 Boss 分開存放.
+     * 普通敵機本體在 enemies (連續, 位址固定), 區塊只記索引 */
+    Enemy* enemies;
+    int enemy_count;
+    int enemy_capacity;
+    Chunk* chunks;
+    int chunk_cols;
+    int chunk_rows;
+    Chunk* wheel;               /* 時間輪, WAKE_WHEEL_SIZE 格, 依 wake 排程 */
+    guint32 tick;
+    Enemy bosses[MAX_BOSSES];
+    int boss_count;
+    double enemy_spawn_timer;
+
+    /* 分數 / 時間 */
+    int score;
+
+    double dodge_score_timer;
+    double time_left;
+    gboolean time_attack_done;
+
+    int enemies_killed;
+    gboolean boss_spawned;
+
+    /* 本 tick 發生的事件 (超過 MAX_TICK_EVENTS 的捨棄) */
+    guint8 events[MAX_TICK_EVENTS];
+    int event_count;
+
+} GameData;
+
+/* 執行期參數 */
+void tuning_set_defaults(Tuning* t);
+gboolean tuning_load(const char* path, Tuning* t, GError** error);
+
+/* 初始化 / 釋放 / 開局 / 結束 */
+void game_data_init(GameData* gd, const Tuning* tuning);
+void game_data_free(GameData* gd);
+void game_reset(GameData* gd);
+void game_return_to_menu(GameData* gd);
+
+/* 覆蓋地圖矩形 (x0, y0)-(x1, y1) 的區塊範圍 (含兩端, 已夾在格內) */
+void game_chunk_range(const GameData* gd, double x0, double y0, double x1, double y1,
+    int* cx0, int* cy0, int* cx1, int* cy1);
+
+/* 推進一個 tick; 結束時 state 會變回 STATE_MENU */
+void game_step(GameData* gd, double dt);
+
+/* 把所有普通敵機的座標補到目前 tick (O(敵機數), 連跑多個 tick 後呼叫一次即可) */
+void game_sync_positions(GameData* gd);
+
+/* 各模式每 tick 耗時 (--bench) */
+void game_run_benchmark(GameData* gd);
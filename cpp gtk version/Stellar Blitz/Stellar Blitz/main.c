@@ -5,116 +5,116 @@
 #include <time.h>
 #include <string.h>
 
+#include "audio.h"
+#include "frame_export.h"
+#include "game.h"
+
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
-/* === 視窗大小 & 更新頻率 === */
-#define WINDOW_WIDTH   800
-#define WINDOW_HEIGHT  600
-#define GAME_TICK_MS   16
-
-/* 玩家/敵人/子彈相關常數 (與您先前相同) */
-#define PLAYER_SPEED   5.0
-#define PLAYER_SIZE    20.0
-#define INVINCIBLE_TIME 1.0
-#define HP_MAX         3
-
-#define BULLET_SPEED   8.0
-#define BULLET_SIZE    5
-#define BULLET_COOLDOWN 0.2
-
-#define ENEMY_SIZE     15
-#define ENEMY_SPEED    2.0
-#define ENEMY_SCORE    100
-#define ENEMY_SPAWN_INTERVAL 1.0
-
-/* 模式相關常數 */
-#define DODGE_SCORE_PER_SEC  10
-#define TIME_ATTACK_LIMIT    60.0
-#define CONQUEST_KILL_TARGET 10
-#define BOSS_SIZE_RATIO      5.0
-#define BOSS_SPEED_RATIO     0.75
-#define BOSS_HP              5
-#define BOSS_SCORE           500
-
-/* 遊戲狀態 / 模式列舉 */
+/* 執行期參數檔 (可用環境變數 STELLAR_CONFIG 指定路徑) */
+#define CONFIG_FILE          "stellar.ini"
+
+/* 音效: 預設輸出到音效卡 (Windows waveOut, 其他平台為 null); 環境變數 STELLAR_AUDIO_WAV 指定檔名時改錄成 WAV */
+#define AUDIO_WAV_ENV        "STELLAR_AUDIO_WAV"
+#define AUDIO_TEST_FILE      "stellar_audio.wav"
+#define AUDIO_TEST_SECONDS   5
+
+/* 畫面快照輸出: 環境變數 STELLAR_EXPORT 非空時, 每幀寫入共享記憶體 (見 frame_shm.h) */
+#define FRAME_EXPORT_ENV     "STELLAR_EXPORT"
+#define EXPORT_TEST_SECONDS  10
+
+/* 畫質調節 (Quality Governor) 相關常數 */
+#define GOV_MIN_FRAME_MS     16.0   /* 每幀預算下限 (約 60 Hz 的更新間隔) */
+#define GOV_WINDOW           60     /* 滾動視窗取樣幀數 */
+#define GOV_HOLD_FRAMES      90     /* 每次切換後的冷卻幀數 */
+#define GOV_DEGRADE_RATIO    0.90   /* 平均耗時 > 預算*此值 => 降一級 */
+#define GOV_RESTORE_RATIO    0.45   /* 平均耗時 < 預算*此值 => 升一級 */
+#define GOV_STUTTER_RATIO    1.50   /* 平均幀間隔 > 預算*此值 => 視為卡頓 */
+#define GOV_FRAME_CAP_RATIO  4.0    /* 幀間隔 > 預算*此值 (視窗隱藏 / 暫停) => 不取樣 */
+#define LOWRES_SCALE         0.5    /* 低解析度模式的渲染比例 */
+#define HUD_HEIGHT           40
+
+/* 畫質等級: 數字越大越省, 每一級包含前面所有級的省略 */
 typedef enum {
-    STATE_MENU,
-    STATE_GAME
-} GameState;
+    QUALITY_FULL,        /* 全畫質 */
+    QUALITY_NO_AA,       /* 關閉 cairo 反鋸齒 */
+    QUALITY_SIMPLE_HUD,  /* HUD 快取成圖, 內容改變才重畫 */
+    QUALITY_FX_CAP,      /* 特效上限: 無敵不閃爍, 子彈畫成方塊 */
+    QUALITY_LOW_RES,     /* 降低渲染解析度再放大 */
+    QUALITY_LEVEL_COUNT
+} QualityLevel;
+
+/* 畫質調節器: 以滾動視窗追蹤 tick / draw / 幀間隔 */
+typedef struct {
+    QualityLevel level;
+    int hold;                      /* 冷卻中, 不做決策 */
 
-typedef enum {
-    MODE_DODGE,
-    MODE_TIME_ATTACK,
-    MODE_CONQUEST
-} GameMode;
+    double tick_ms[GOV_WINDOW];    /* 該幀期間 game_update 總耗時 */
+    double draw_ms[GOV_WINDOW];    /* on_draw 耗時 */
+    double frame_ms[GOV_WINDOW];   /* 兩次 on_draw 的間隔 */
+    double tick_sum, draw_sum, frame_sum;
+    int head;
+    int count;
 
-/* 子彈 / 敵機資料結構 */
-typedef struct {
-    double x, y;
-    double speed;
-} Bullet;
+    double budget_ms;              /* 每幀預算 (tick + draw), 跟著 tick_ms 走 */
+    double pending_tick_ms;        /* 上次繪圖後累積的 tick 耗時 */
+    gint64 last_draw_us;
 
+    /* 簡化 HUD 用的快取 */
+    cairo_surface_t* hud_surface;
+    char hud_text[128];
+
+    /* 離屏畫布: 每一級都先在 CPU 上光柵化, draw_ms 才可比較 */
+    cairo_surface_t* frame_surface;   /* 原解析度整張畫面 */
+    cairo_surface_t* lowres_surface;  /* LOW_RES 時的縮小場景 */
+
+    gboolean show_overlay;         /* F3 切換除錯資訊 */
+    char last_decision[96];
+} QualityGovernor;
+
+/* === 介面資料 (GTK 視窗 + 遊戲邏輯) === */
 typedef struct {
-    double x, y;
-    double dx, dy;
-    double speed;
-    gboolean is_boss;
-    int boss_hp;
-} Enemy;
-
-/* === 遊戲資料 === */
-typedef struct {
-    GameState state;
-    GameMode  mode;
+    GameData game;              /* 遊戲邏輯 (game.c) */
 
     GtkWidget* window;
     GtkWidget* stack;
     GtkWidget* page_menu;
     GtkWidget* page_game;
 
-    int width;
-    int height;
-
-    /* 玩家 */
-    double player_x, player_y;
-    int hp;
-    gboolean invincible;
-    double invincible_timer;
-    gboolean up_pressed;
-    gboolean down_pressed;
-    gboolean left_pressed;
-    gboolean right_pressed;
-    gboolean space_pressed;
-
-    /* 子彈 */
-    GList* bullets;
-    double bullet_cooldown;
-
-    /* 敵機 */
-    GList* enemies;
-    double enemy_spawn_timer;
-
-    /* 分數 / 時間 */
-    int score;
     double last_time;
 
-    double dodge_score_timer;
-    double time_left;
-    gboolean time_attack_done;
-
-    int enemies_killed;
-    gboolean boss_spawned;
-
     /* 防止重複啟動計時器 */
     gboolean game_loop_started;
 
-} GameData;
+    /* 畫質調節 */
+    QualityGovernor gov;
+
+    /* 上一幀實際畫出的普通敵機數 (F3) */
+    int drawn_enemies;
+
+    /* 音效 (混音執行緒) */
+    Audio* audio;
+
+    /* 畫面快照輸出 (NULL = 關閉) */
+    FrameExport* frame_export;
+
+    /* 執行期參數 */
+    const Tuning* tuning;       /* 目前生效 (只讀), game.tuning 指向同一份 */
+    Tuning* pending_tuning;     /* 已解析, 等下一個 tick 邊界套用 */
+    double pending_parse_ms;
+    double cfg_parse_ms;        /* 最近一次重載的解析 / 套用耗時 */
+    double cfg_apply_ms;
+    char* config_path;
+    GFileMonitor* config_monitor;
+    guint tick_ms_active;       /* 目前計時器的間隔 */
+
+} AppData;
 
 /* 前置函式宣告 */
 static void app_activate(GApplication* app, gpointer user_data);
-static void build_ui(GameData* gd);
+static void build_ui(AppData* ui);
 
 /* 三個模式按鈕 + Exit 按鈕 */
 static void on_button_dodge_clicked(GtkButton* btn, gpointer user_data);
@@ -123,29 +123,47 @@ static void on_button_conquest_clicked(GtkButton* btn, gpointer user_data);
 static void on_button_exit_clicked(GtkButton* btn, gpointer user_data);
 
 /* 進入 / 返回 遊戲 */
-static void start_game(GameData* gd);
-static void game_return_to_menu(GameData* gd);
-
-/* 工具函式 */
-static double rand_range(double min, double max);
-static gboolean circle_collide(double x1, double y1, double r1,
-    double x2, double y2, double r2);
-static void game_data_init(GameData* gd);
-
-/* 建立子彈 / 敵機 */
-static Bullet* bullet_new(double x, double y);
-static Enemy* enemy_new_normal(int w, int h);
-static Enemy* enemy_new_boss(GameData* gd);
-
-/* 依模式判斷能否開火 */
-static gboolean can_player_fire(GameData* gd);
-
-/* 模式與邏輯更新 */
-static void update_mode_specific(GameData* gd, double dt);
-static void game_update(GameData* gd);
+static void start_game(AppData* ui);
+static void show_menu(AppData* ui);
+static void app_data_init(AppData* ui);
+
+/* 邏輯更新 */
+static void game_update(AppData* ui);
 static gboolean game_loop(gpointer user_data);
 
+/* 音效 */
+static Audio* audio_open(const char* wav_path);
+static void audio_post_events(AppData* ui);
+static void audio_print_stats(Audio* audio);
+
+/* 畫面快照輸出 */
+static FrameExport* frame_export_start(void);
+static void frame_export_print_stats(FrameExport* fx);
+
+/* 不開視窗自動玩 (--audio-test / --export-test) */
+static void run_autoplay(AppData* ui, int seconds);
+
+/* 執行期參數 / 熱重載 */
+static void config_init(AppData* ui);
+static void config_free(AppData* ui);
+static void config_apply_pending(AppData* ui);
+static void on_config_changed(GFileMonitor* monitor, GFile* file, GFile* other_file,
+    GFileMonitorEvent event_type, gpointer user_data);
+
+/* 畫質調節 */
+static void governor_init(QualityGovernor* gov);
+static void governor_reset_window(QualityGovernor* gov);
+static void governor_set_budget(QualityGovernor* gov, guint tick_ms);
+static void governor_free(QualityGovernor* gov);
+static cairo_surface_t* governor_surface(cairo_surface_t** slot, int w, int h);
+static void governor_record_frame(QualityGovernor* gov, double draw_ms, gint64 now_us);
+static void governor_evaluate(QualityGovernor* gov);
+static const char* quality_level_name(QualityLevel level);
+
 /* 繪圖 & 鍵盤事件 */
+static void draw_scene(AppData* ui, cairo_t* cr);
+static void draw_hud(AppData* ui, cairo_t* cr, int w);
+static void draw_debug_overlay(AppData* ui, cairo_t* cr);
 static void on_draw(GtkDrawingArea* area, cairo_t* cr,
     int w, int h, gpointer user_data);
 static gboolean on_key_press(GtkEventControllerKey* ctrl,
@@ -161,52 +179,102 @@ int main(int argc, char* argv[])
     setlocale(LC_ALL, "");
     srand((unsigned int)time(NULL));
 
-    GameData* gd = g_new0(GameData, 1);
-    game_data_init(gd);
+    AppData* ui = g_new0(AppData, 1);
+    config_init(ui);
+    app_data_init(ui);
+
+    /* --bench: 不開視窗, 量各模式與大地圖的每 tick 耗時 */
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        game_run_benchmark(&ui->game);
+        game_data_free(&ui->game);
+        config_free(ui);
+        g_free(ui);
+        return 0;
+    }
+
+    /* --audio-test [out.wav]: 不開視窗, 自動玩幾秒並把音效錄成 WAV
+     * --export-test [秒數]: 不開視窗, 自動玩並輸出快照給 spectator */
+    if (argc > 1 && (strcmp(argv[1], "--audio-test") == 0 || strcmp(argv[1], "--export-test") == 0)) {
+        int seconds;
+        if (strcmp(argv[1], "--audio-test") == 0) {
+            const char* wav_path = argc > 2 ? argv[2] : AUDIO_TEST_FILE;
+            ui->audio = audio_open(wav_path);
+            seconds = AUDIO_TEST_SECONDS;
+        }
+        else {
+            ui->frame_export = frame_export_start();
+            seconds = argc > 2 ? atoi(argv[2]) : EXPORT_TEST_SECONDS;
+        }
+
+        run_autoplay(ui, seconds);
+
+        audio_print_stats(ui->audio);
+        audio_free(ui->audio);
+        frame_export_print_stats(ui->frame_export);
+        frame_export_close(ui->frame_export);
+        game_data_free(&ui->game);
+        config_free(ui);
+        g_free(ui);
+        return 0;
+    }
+
+    ui->audio = audio_open(g_getenv(AUDIO_WAV_ENV));
+    if (g_getenv(FRAME_EXPORT_ENV) && *g_getenv(FRAME_EXPORT_ENV)) {
+        ui->frame_export = frame_export_start();
+    }
 
     GtkApplication* app = gtk_application_new("org.example.StellarBlitz3Buttons",
         G_APPLICATION_DEFAULT_FLAGS);
-    g_signal_connect(app, "activate", G_CALLBACK(app_activate), gd);
+    g_signal_connect(app, "activate", G_CALLBACK(app_activate), ui);
 
     int status = g_application_run(G_APPLICATION(app), argc, argv);
 
     g_object_unref(app);
-    g_free(gd);
+    audio_print_stats(ui->audio);
+    audio_free(ui->audio);
+    frame_export_print_stats(ui->frame_export);
+    frame_export_close(ui->frame_export);
+    governor_free(&ui->gov);
+    game_data_free(&ui->game);
+    config_free(ui);
+    g_free(ui);
     return status;
 }
 
 /* === app_activate === */
 static void app_activate(GApplication* app, gpointer user_data)
 {
-    GameData* gd = (GameData*)user_data;
+    AppData* ui = (AppData*)user_data;
 
-    gd->window = gtk_application_window_new(GTK_APPLICATION(app));
-    gtk_window_set_title(GTK_WINDOW(gd->window), "Stellar Blitz - 3 Buttons (Dodge/Time/Conquest)");
-    gtk_window_set_default_size(GTK_WINDOW(gd->window), WINDOW_WIDTH, WINDOW_HEIGHT);
-    gtk_window_set_resizable(GTK_WINDOW(gd->window), FALSE);
+    ui->window = gtk_application_window_new(GTK_APPLICATION(app));
+    gtk_window_set_title(GTK_WINDOW(ui->window), "Stellar Blitz - 3 Buttons (Dodge/Time/Conquest)");
+    gtk_window_set_default_size(GTK_WINDOW(ui->window), WINDOW_WIDTH, WINDOW_HEIGHT);
+    gtk_window_set_resizable(GTK_WINDOW(ui->window), FALSE);
 
-    build_ui(gd);
-    gtk_widget_show(gd->window);
+    build_ui(ui);
+    gtk_widget_show(ui->window);
 
     /* 只啟動一次遊戲迴圈 */
-    if (!gd->game_loop_started) {
-        g_timeout_add(GAME_TICK_MS, game_loop, gd);
-        gd->game_loop_started = TRUE;
+    if (!ui->game_loop_started) {
+        ui->tick_ms_active = (guint)ui->tuning->game_tick_ms;
+        governor_set_budget(&ui->gov, ui->tick_ms_active);
+        g_timeout_add(ui->tick_ms_active, game_loop, ui);
+        ui->game_loop_started = TRUE;
     }
 }
 
 /* === 建立主選單介面 (三個模式按鈕 + Exit) === */
-static void build_ui(GameData* gd)
+static void build_ui(AppData* ui)
 {
     /* 若 stack 已被建立，跳過 */
-    if (gd->stack) {
+    if (ui->stack) {
         g_print("[WARN] build_ui() called again => skip\n");
         return;
     }
 
-    gd->stack = gtk_stack_new();
-    gtk_stack_set_transition_type(GTK_STACK(gd->stack), GTK_STACK_TRANSITION_TYPE_CROSSFADE);
-    gtk_stack_set_transition_duration(GTK_STACK(gd->stack), 300);
+    ui->stack = gtk_stack_new();
+    gtk_stack_set_transition_type(GTK_STACK(ui->stack), GTK_STACK_TRANSITION_TYPE_CROSSFADE);
+    gtk_stack_set_transition_duration(GTK_STACK(ui->stack), 300);
 
     /* 建立垂直 box */
     GtkWidget* vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 10);
@@ -224,10 +292,10 @@ static void build_ui(GameData* gd)
     GtkWidget* btn_exit = gtk_button_new_with_label("Exit");
 
     /* 連結事件 */
-    g_signal_connect(btn_dodge, "clicked", G_CALLBACK(on_button_dodge_clicked), gd);
-    g_signal_connect(btn_time, "clicked", G_CALLBACK(on_button_time_clicked), gd);
-    g_signal_connect(btn_conquest, "clicked", G_CALLBACK(on_button_conquest_clicked), gd);
-    g_signal_connect(btn_exit, "clicked", G_CALLBACK(on_button_exit_clicked), gd);
+    g_signal_connect(btn_dodge, "clicked", G_CALLBACK(on_button_dodge_clicked), ui);
+    g_signal_connect(btn_time, "clicked", G_CALLBACK(on_button_time_clicked), ui);
+    g_signal_connect(btn_conquest, "clicked", G_CALLBACK(on_button_conquest_clicked), ui);
+    g_signal_connect(btn_exit, "clicked", G_CALLBACK(on_button_exit_clicked), ui);
 
     /* 放入 vbox */
     gtk_box_append(GTK_BOX(vbox), btn_dodge);
@@ -236,37 +304,37 @@ static void build_ui(GameData* gd)
     gtk_box_append(GTK_BOX(vbox), btn_exit);
 
     /* 作為主選單 */
-    gd->page_menu = vbox;
+    ui->page_menu = vbox;
     /* 預設的 page_game (placeholder) */
-    gd->page_game = gtk_label_new("Placeholder: Press One of the Mode Buttons to start");
+    ui->page_game = gtk_label_new("Placeholder: Press One of the Mode Buttons to start");
 
-    gtk_stack_add_named(GTK_STACK(gd->stack), gd->page_menu, "menu");
-    gtk_stack_add_named(GTK_STACK(gd->stack), gd->page_game, "game");
-    gtk_stack_set_visible_child_name(GTK_STACK(gd->stack), "menu");
+    gtk_stack_add_named(GTK_STACK(ui->stack), ui->page_menu, "menu");
+    gtk_stack_add_named(GTK_STACK(ui->stack), ui->page_game, "game");
+    gtk_stack_set_visible_child_name(GTK_STACK(ui->stack), "menu");
 
-    gtk_window_set_child(GTK_WINDOW(gd->window), gd->stack);
+    gtk_window_set_child(GTK_WINDOW(ui->window), ui->stack);
 }
 
 /* === 三個模式按鈕之回呼 === */
 static void on_button_dodge_clicked(GtkButton* btn, gpointer user_data)
 {
-    GameData* gd = (GameData*)user_data;
-    gd->mode = MODE_DODGE;      /* 設定模式: 閃躲 */
-    start_game(gd);            /* 進入遊戲 */
+    AppData* ui = (AppData*)user_data;
+    ui->game.mode = MODE_DODGE;      /* 設定模式: 閃躲 */
+    start_game(ui);                 /* 進入遊戲 */
 }
 
 static void on_button_time_clicked(GtkButton* btn, gpointer user_data)
 {
-    GameData* gd = (GameData*)user_data;
-    gd->mode = MODE_TIME_ATTACK;/* 設定模式: 限時奪分 */
-    start_game(gd);            /* 進入遊戲 */
+    AppData* ui = (AppData*)user_data;
+    ui->game.mode = MODE_TIME_ATTACK;/* 設定模式: 限時奪分 */
+    start_game(ui);                 /* 進入遊戲 */
 }
 
 static void on_button_conquest_clicked(GtkButton* btn, gpointer user_data)
 {
-    GameData* gd = (GameData*)user_data;
-    gd->mode = MODE_CONQUEST;   /* 設定模式: 討伐Boss */
-    start_game(gd);            /* 進入遊戲 */
+    AppData* ui = (AppData*)user_data;
+    ui->game.mode = MODE_CONQUEST;   /* 設定模式: 討伐Boss */
+    start_game(ui);                 /* 進入遊戲 */
 }
 
 static void on_button_exit_clicked(GtkButton* btn, gpointer user_data)
@@ -278,478 +346,603 @@ static void on_button_exit_clicked(GtkButton* btn, gpointer user_data)
 }
 
 /* === 開始遊戲 (共用) === */
-static void start_game(GameData* gd)
-{
-    gd->state = STATE_GAME;
-
-    /* 清除敵人/子彈 */
-    g_list_free_full(gd->bullets, g_free);
-    gd->bullets = NULL;
-    g_list_free_full(gd->enemies, g_free);
-    gd->enemies = NULL;
-
-    /* 重設玩家 / 分數 / 狀態 */
-    gd->hp = HP_MAX;
-    gd->invincible = FALSE;
-    gd->invincible_timer = 0.0;
-    gd->up_pressed = FALSE;
-    gd->down_pressed = FALSE;
-    gd->left_pressed = FALSE;
-    gd->right_pressed = FALSE;
-    gd->space_pressed = FALSE;
-
-    gd->bullet_cooldown = 0.0;
-    gd->enemy_spawn_timer = 0.0;
-
-    gd->player_x = gd->width / 2.0;
-    gd->player_y = gd->height / 2.0;
-    gd->score = 0;
-    gd->dodge_score_timer = 0.0;
-    gd->time_left = TIME_ATTACK_LIMIT;
-    gd->time_attack_done = FALSE;
-    gd->enemies_killed = 0;
-    gd->boss_spawned = FALSE;
-    gd->last_time = (double)g_get_monotonic_time() / 1000000.0;
-
-    /* 新的遊戲畫面 */
+static void start_game(AppData* ui)
+{
+    GameData* gd = &ui->game;
+    game_reset(gd);
+    ui->last_time = (double)g_get_monotonic_time() / 1000000.0;
+
+    /* 選單期間沒有繪圖, 丟掉舊取樣以免幀間隔被誤判 (畫質等級保留) */
+    governor_reset_window(&ui->gov);
+
+    /* 新的遊戲畫面 (鏡頭視野大小, 不是地圖大小) */
     GtkWidget* drawing_area = gtk_drawing_area_new();
-    gtk_drawing_area_set_content_width(GTK_DRAWING_AREA(drawing_area), gd->width);
-    gtk_drawing_area_set_content_height(GTK_DRAWING_AREA(drawing_area), gd->height);
+    gtk_drawing_area_set_content_width(GTK_DRAWING_AREA(drawing_area), WINDOW_WIDTH);
+    gtk_drawing_area_set_content_height(GTK_DRAWING_AREA(drawing_area), WINDOW_HEIGHT);
 
     gtk_widget_set_focusable(drawing_area, TRUE);
     GtkEventController* keyctrl = gtk_event_controller_key_new();
-    g_signal_connect(keyctrl, "key-pressed", G_CALLBACK(on_key_press), gd);
-    g_signal_connect(keyctrl, "key-released", G_CALLBACK(on_key_release), gd);
+    g_signal_connect(keyctrl, "key-pressed", G_CALLBACK(on_key_press), ui);
+    g_signal_connect(keyctrl, "key-released", G_CALLBACK(on_key_release), ui);
     gtk_widget_add_controller(drawing_area, keyctrl);
 
-    gtk_drawing_area_set_draw_func(GTK_DRAWING_AREA(drawing_area), on_draw, gd, NULL);
+    gtk_drawing_area_set_draw_func(GTK_DRAWING_AREA(drawing_area), on_draw, ui, NULL);
 
-    if (gd->stack && GTK_IS_STACK(gd->stack)) {
-        if (gtk_stack_get_child_by_name(GTK_STACK(gd->stack), "game") != NULL) {
-            gtk_stack_remove(GTK_STACK(gd->stack), gd->page_game);
+    if (ui->stack && GTK_IS_STACK(ui->stack)) {
+        if (gtk_stack_get_child_by_name(GTK_STACK(ui->stack), "game") != NULL) {
+            gtk_stack_remove(GTK_STACK(ui->stack), ui->page_game);
         }
-        gd->page_game = drawing_area;
-        gtk_stack_add_named(GTK_STACK(gd->stack), gd->page_game, "game");
-        gtk_stack_set_visible_child_name(GTK_STACK(gd->stack), "game");
+        ui->page_game = drawing_area;
+        gtk_stack_add_named(GTK_STACK(ui->stack), ui->page_game, "game");
+        gtk_stack_set_visible_child_name(GTK_STACK(ui->stack), "game");
+    }
+}
+
+/* === 回主選單 (遊戲邏輯已在 game_return_to_menu 清空) === */
+static void show_menu(AppData* ui)
+{
+    if (ui->stack && GTK_IS_STACK(ui->stack)) {
+        gtk_stack_set_visible_child_name(GTK_STACK(ui->stack), "menu");
     }
 }
 
-/* === 回主選單 === */
-static void game_return_to_menu(GameData* gd)
+/* === 初始化介面資料 === */
+static void app_data_init(AppData* ui)
 {
-    gd->state = STATE_MENU;
+    game_data_init(&ui->game, ui->tuning);
 
-    g_list_free_full(gd->bullets, g_free);
-    gd->bullets = NULL;
-    g_list_free_full(gd->enemies, g_free);
-    gd->enemies = NULL;
+    ui->window = NULL;
+    ui->stack = NULL;
+    ui->page_menu = NULL;
+    ui->page_game = NULL;
 
-    if (gd->stack && GTK_IS_STACK(gd->stack)) {
-        gtk_stack_set_visible_child_name(GTK_STACK(gd->stack), "menu");
-    }
+    ui->last_time = (double)g_get_monotonic_time() / 1000000.0;
+
+    ui->game_loop_started = FALSE;
+
+    governor_init(&ui->gov);
+    ui->drawn_enemies = 0;
+    ui->audio = NULL;
+    ui->frame_export = NULL;
 }
 
-/* === 初始化遊戲資料 === */
-static void game_data_init(GameData* gd)
+/* 主遊戲更新 */
+static void game_update(AppData* ui)
 {
-    gd->state = STATE_MENU;
-    gd->mode = MODE_DODGE; /* 預設 Dodge */
+    double now = (double)g_get_monotonic_time() / 1000000.0;
+    double dt = now - ui->last_time;
+    ui->last_time = now;
+
+    game_step(&ui->game, dt);
+    audio_post_events(ui);
 
-    gd->window = NULL;
-    gd->stack = NULL;
-    gd->page_menu = NULL;
-    gd->page_game = NULL;
+    /* 邏輯判定結束 => 回主選單 */
+    if (ui->game.state != STATE_GAME) {
+        show_menu(ui);
+    }
+}
 
-    gd->width = WINDOW_WIDTH;
-    gd->height = WINDOW_HEIGHT;
+/* === game_loop === */
+static gboolean game_loop(gpointer user_data)
+{
+    AppData* ui = (AppData*)user_data;
+
+    /* tick 邊界: 套用熱重載的參數 */
+    if (ui->pending_tuning) {
+        config_apply_pending(ui);
+
+        /* 計時器間隔改變 => 換一個新的計時器, 舊的這次回傳後移除 */
+        if ((guint)ui->tuning->game_tick_ms != ui->tick_ms_active) {
+            ui->tick_ms_active = (guint)ui->tuning->game_tick_ms;
+            governor_set_budget(&ui->gov, ui->tick_ms_active);
+            g_timeout_add(ui->tick_ms_active, game_loop, ui);
+            return G_SOURCE_REMOVE;
+        }
+    }
 
-    gd->player_x = gd->width / 2.0;
-    gd->player_y = gd->height / 2.0;
-    gd->hp = HP_MAX;
-    gd->invincible = FALSE;
-    gd->invincible_timer = 0.0;
+    if (ui->game.state == STATE_GAME) {
+        gint64 t0 = g_get_monotonic_time();
+        game_update(ui);
+        if (ui->frame_export) {
+            frame_export_publish(ui->frame_export, &ui->game);
+        }
+        ui->gov.pending_tick_ms += (double)(g_get_monotonic_time() - t0) / 1000.0;
+        gtk_widget_queue_draw(ui->page_game);
+    }
+    return TRUE;
+}
 
-    gd->up_pressed = FALSE;
-    gd->down_pressed = FALSE;
-    gd->left_pressed = FALSE;
-    gd->right_pressed = FALSE;
-    gd->space_pressed = FALSE;
+/* === 音效 === */
+/* 以 GameEventType 為索引 */
+static const AudioSound event_sounds[] = {
+    SOUND_SHOOT,        /* GAME_EVENT_SHOOT */
+    SOUND_HIT,          /* GAME_EVENT_HIT */
+    SOUND_KILL,         /* GAME_EVENT_KILL */
+    SOUND_BOSS_SPAWN,   /* GAME_EVENT_BOSS_SPAWN */
+    SOUND_BOSS_KILL     /* GAME_EVENT_BOSS_KILL */
+};
+
+/* wav_path 為 NULL 時輸出到音效卡; WAV 或音效卡開不了就退回 null sink */
+static Audio* audio_open(const char* wav_path)
+{
+    AudioSink* sink = NULL;
+    GError* err = NULL;
+    if (wav_path && *wav_path) {
+        sink = audio_sink_wav_new(wav_path, &err);
+    }
+    else {
+        sink = audio_sink_device_new(&err);
+    }
+    if (!sink) {
+        g_print("[AUDIO] %s => null sink\n", err->message);
+        g_error_free(err);
+        sink = audio_sink_null_new();
+    }
 
-    gd->bullets = NULL;
-    gd->bullet_cooldown = 0.0;
+    Audio* audio = audio_new(sink);
+    g_print("[AUDIO] %s sink, %d Hz, block %d frames\n",
+        audio_sink_name(audio), AUDIO_RATE, AUDIO_BLOCK_FRAMES);
+    return audio;
+}
 
-    gd->enemies = NULL;
-    gd->enemy_spawn_timer = 0.0;
+/* 把這個 tick 的遊戲事件丟給混音執行緒 (不會阻塞) */
+static void audio_post_events(AppData* ui)
+{
+    GameData* gd = &ui->game;
+    if (!ui->audio) return;
 
-    gd->score = 0;
-    gd->last_time = (double)g_get_monotonic_time() / 1000000.0;
+    for (int i = 0; i < gd->event_count; i++) {
+        audio_post(ui->audio, event_sounds[gd->events[i]]);
+    }
+}
 
-    gd->dodge_score_timer = 0.0;
-    gd->time_left = TIME_ATTACK_LIMIT;
-    gd->time_attack_done = FALSE;
-    gd->enemies_killed = 0;
-    gd->boss_spawned = FALSE;
+static void audio_print_stats(Audio* audio)
+{
+    AudioStats st;
+    if (!audio) return;
 
-    gd->game_loop_started = FALSE;
+    audio_get_stats(audio, &st);
+    g_print("[AUDIO] %u blocks | block avg %.3f ms max %.3f ms (budget %.2f ms) | underruns %u | dropped events %u\n",
+        st.blocks, st.block_avg_ms, st.block_max_ms,
+        1000.0 * AUDIO_BLOCK_FRAMES / AUDIO_RATE, st.underruns, st.dropped_events);
 }
 
-/* === 工具 === */
-static double rand_range(double min, double max)
+/* === 畫面快照輸出 === */
+/* 開不了就不輸出, 遊戲照常進行 */
+static FrameExport* frame_export_start(void)
 {
-    return min + (double)rand() / (double)RAND_MAX * (max - min);
+    GError* err = NULL;
+    FrameExport* fx = frame_export_open(&err);
+    if (!fx) {
+        g_print("[EXPORT] %s => disabled\n", err->message);
+        g_error_free(err);
+        return NULL;
+    }
+    return fx;
 }
 
-static gboolean circle_collide(double x1, double y1, double r1,
-    double x2, double y2, double r2)
+static void frame_export_print_stats(FrameExport* fx)
 {
-    double dx = x2 - x1;
-    double dy = y2 - y1;
-    double dist2 = dx * dx + dy * dy;
-    double rr = (r1 + r2) * (r1 + r2);
-    return(dist2 <= rr);
+    FrameExportStats st;
+    if (!fx) return;
+
+    frame_export_get_stats(fx, &st);
+    g_print("[EXPORT] %u frames | publish avg %.2f us max %.0f us | truncated %u\n",
+        st.frames, st.publish_avg_us, st.publish_max_us, st.truncated);
 }
 
-/* 建立子彈/敵機 */
-static Bullet* bullet_new(double x, double y)
+/* === 自動玩 ===
+ * 以實際 tick 速度玩 Conquest (一直開火, 左右來回), 死掉或打倒 Boss 就重開.
+ * 有開音效 / 快照輸出就照常送出. */
+static void run_autoplay(AppData* ui, int seconds)
 {
-    Bullet* b = g_new0(Bullet, 1);
-    b->x = x; b->y = y;
-    b->speed = BULLET_SPEED;
-    return b;
+    GameData* gd = &ui->game;
+    int tick_ms = ui->tuning->game_tick_ms;
+    int ticks = seconds * 1000 / tick_ms;
+    double dt = tick_ms / 1000.0;
+
+    gd->mode = MODE_CONQUEST;
+    game_reset(gd);
+
+    gint64 start = g_get_monotonic_time();
+    for (int i = 0; i < ticks; i++) {
+        gboolean left = (i / 120) % 2;
+        gd->left_pressed = left;
+        gd->right_pressed = !left;
+        gd->space_pressed = TRUE;
+
+        game_step(gd, dt);
+        audio_post_events(ui);
+        if (ui->frame_export) {
+            frame_export_publish(ui->frame_export, gd);
+        }
+        if (gd->state != STATE_GAME) {
+            game_reset(gd);
+        }
+
+        gint64 wake = start + (gint64)(i + 1) * tick_ms * 1000;
+        gint64 now = g_get_monotonic_time();
+        if (wake > now) g_usleep((gulong)(wake - now));
+    }
 }
 
-static Enemy* enemy_new_normal(int w, int h)
+/* === 執行期參數 / 熱重載 === */
+/* 啟動時載入一次, 並監看檔案變動 (Linux 上 GFileMonitor 底層即 inotify) */
+static void config_init(AppData* ui)
 {
-    Enemy* e = g_new0(Enemy, 1);
-    e->is_boss = FALSE;
-    e->boss_hp = 0;
+    const char* env = g_getenv("STELLAR_CONFIG");
+    ui->config_path = g_strdup(env ? env : CONFIG_FILE);
+
+    Tuning* t = g_new0(Tuning, 1);
+    tuning_set_defaults(t);
 
-    int edge = rand() % 4;
-    if (edge == 0) {
-        e->x = rand_range(0, w); e->y = 0;
+    GError* err = NULL;
+    gint64 t0 = g_get_monotonic_time();
+    if (tuning_load(ui->config_path, t, &err)) {
+        ui->cfg_parse_ms = (double)(g_get_monotonic_time() - t0) / 1000.0;
+        g_print("[CFG] loaded %s (parse %.3f ms)\n", ui->config_path, ui->cfg_parse_ms);
     }
-    else if (edge == 1) {
-        e->x = rand_range(0, w); e->y = h;
+    else {
+        g_print("[CFG] %s: %s => using built-in defaults\n", ui->config_path, err->message);
+        g_error_free(err);
     }
-    else if (edge == 2) {
-        e->x = 0; e->y = rand_range(0, h);
+    ui->tuning = t;
+    ui->pending_tuning = NULL;
+
+    /* 檔案不存在也監看, 之後建立時一樣會被載入 */
+    GFile* file = g_file_new_for_path(ui->config_path);
+    ui->config_monitor = g_file_monitor_file(file, G_FILE_MONITOR_NONE, NULL, &err);
+    g_object_unref(file);
+    if (ui->config_monitor) {
+        g_signal_connect(ui->config_monitor, "changed", G_CALLBACK(on_config_changed), ui);
     }
     else {
-        e->x = w; e->y = rand_range(0, h);
+        g_print("[CFG] hot reload disabled: %s\n", err->message);
+        g_error_free(err);
     }
-
-    double tx = rand_range(0, w), ty = rand_range(0, h);
-    double dx = tx - e->x, dy = ty - e->y;
-    double length = sqrt(dx * dx + dy * dy);
-    if (length > 0) { e->dx = dx / length; e->dy = dy / length; }
-    else { e->dx = 0; e->dy = 1; }
-    e->speed = ENEMY_SPEED;
-    return e;
 }
 
-static Enemy* enemy_new_boss(GameData* gd)
+static void config_free(AppData* ui)
 {
-    Enemy* e = g_new0(Enemy, 1);
-    e->is_boss = TRUE;
-    e->boss_hp = BOSS_HP;
+    g_clear_object(&ui->config_monitor);
+    g_free((gpointer)ui->tuning);
+    ui->tuning = NULL;
+    g_free(ui->pending_tuning);
+    ui->pending_tuning = NULL;
+    g_free(ui->config_path);
+    ui->config_path = NULL;
+}
 
-    int edge = rand() % 4;
-    if (edge == 0) {
-        e->x = rand_range(0, gd->width); e->y = 0;
-    }
-    else if (edge == 1) {
-        e->x = rand_range(0, gd->width); e->y = gd->height;
-    }
-    else if (edge == 2) {
-        e->x = 0; e->y = rand_range(0, gd->height);
+/* 檔案寫完才重新解析; 結果先放 pending, 由 game_loop 在 tick 邊界換上 */
+static void on_config_changed(GFileMonitor* monitor, GFile* file, GFile* other_file,
+    GFileMonitorEvent event_type, gpointer user_data)
+{
+    AppData* ui = (AppData*)user_data;
+    if (event_type != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT &&
+        event_type != G_FILE_MONITOR_EVENT_CREATED) {
+        return;
     }
-    else {
-        e->x = gd->width; e->y = rand_range(0, gd->height);
+
+    Tuning* t = g_new0(Tuning, 1);
+    tuning_set_defaults(t);
+
+    GError* err = NULL;
+    gint64 t0 = g_get_monotonic_time();
+    if (!tuning_load(ui->config_path, t, &err)) {
+        g_print("[CFG] reload %s failed: %s => keep current\n", ui->config_path, err->message);
+        g_error_free(err);
+        g_free(t);
+        return;
     }
 
-    double tx = gd->player_x - e->x;
-    double ty = gd->player_y - e->y;
-    double length = sqrt(tx * tx + ty * ty);
-    if (length > 0) { e->dx = tx / length; e->dy = ty / length; }
-    else { e->dx = 0; e->dy = 1; }
-    e->speed = ENEMY_SPEED * BOSS_SPEED_RATIO;
-    return e;
+    /* 同一 tick 內改了兩次, 以最新的為準 */
+    g_free(ui->pending_tuning);
+    ui->pending_tuning = t;
+    ui->pending_parse_ms = (double)(g_get_monotonic_time() - t0) / 1000.0;
 }
 
-/* 是否能開火 (Dodge模式不能) */
-static gboolean can_player_fire(GameData* gd)
+/* 只換指標; 已存在的子彈/敵機維持原速度, 新參數從下一個生成開始生效 */
+static void config_apply_pending(AppData* ui)
 {
-    return (gd->mode != MODE_DODGE);
+    gint64 t0 = g_get_monotonic_time();
+
+    const Tuning* old = ui->tuning;
+    ui->tuning = ui->pending_tuning;
+    ui->game.tuning = ui->tuning;
+    ui->pending_tuning = NULL;
+    g_free((gpointer)old);
+
+    ui->cfg_apply_ms = (double)(g_get_monotonic_time() - t0) / 1000.0;
+    ui->cfg_parse_ms = ui->pending_parse_ms;
+    g_print("[CFG] reloaded %s (parse %.3f ms, apply %.3f ms)\n",
+        ui->config_path, ui->cfg_parse_ms, ui->cfg_apply_ms);
 }
 
-/* 模式處理 */
-static void update_mode_specific(GameData* gd, double dt)
+/* === 畫質調節 === */
+static const char* quality_level_name(QualityLevel level)
 {
-    switch (gd->mode) {
-    case MODE_DODGE:
-        /* 每秒+10分 (非無敵) */
-        gd->dodge_score_timer += dt;
-        while (gd->dodge_score_timer >= 1.0) {
-            gd->dodge_score_timer -= 1.0;
-            if (!gd->invincible && gd->hp > 0) {
-                gd->score += DODGE_SCORE_PER_SEC;
-            }
-        }
-        break;
+    switch (level) {
+    case QUALITY_FULL:       return "FULL";
+    case QUALITY_NO_AA:      return "NO_AA";
+    case QUALITY_SIMPLE_HUD: return "SIMPLE_HUD";
+    case QUALITY_FX_CAP:     return "FX_CAP";
+    case QUALITY_LOW_RES:    return "LOW_RES";
+    default:                 return "?";
+    }
+}
 
-    case MODE_TIME_ATTACK:
-        /* 倒數 */
-        if (!gd->time_attack_done) {
-            gd->time_left -= dt;
-            if (gd->time_left <= 0) {
-                gd->time_left = 0;
-                gd->time_attack_done = TRUE;
-            }
-        }
-        if (gd->time_attack_done || gd->hp <= 0) {
-            /* 時間到 或 HP=0 => 結束 */
-            game_return_to_menu(gd);
-        }
-        break;
+static void governor_init(QualityGovernor* gov)
+{
+    gov->level = QUALITY_FULL;
+    gov->hold = 0;
+    gov->hud_surface = NULL;
+    gov->hud_text[0] = '\0';
+    gov->frame_surface = NULL;
+    gov->lowres_surface = NULL;
+    gov->show_overlay = FALSE;
+    gov->budget_ms = GOV_MIN_FRAME_MS;
+    snprintf(gov->last_decision, sizeof(gov->last_decision), "start at %s",
+        quality_level_name(gov->level));
+    governor_reset_window(gov);
+}
 
-    case MODE_CONQUEST:
-        /* 擊殺一定數量 => 召喚Boss */
-        if (!gd->boss_spawned && gd->enemies_killed >= CONQUEST_KILL_TARGET) {
-            gd->boss_spawned = TRUE;
-            Enemy* boss = enemy_new_boss(gd);
-            gd->enemies = g_list_append(gd->enemies, boss);
-        }
-        if (gd->hp <= 0) {
-            /* HP=0 => 結束 */
-            game_return_to_menu(gd);
-        }
-        break;
-    }
+/* 清空滾動視窗 (切換等級或重新開局時), 等級本身不變 */
+static void governor_reset_window(QualityGovernor* gov)
+{
+    memset(gov->tick_ms, 0, sizeof(gov->tick_ms));
+    memset(gov->draw_ms, 0, sizeof(gov->draw_ms));
+    memset(gov->frame_ms, 0, sizeof(gov->frame_ms));
+    gov->tick_sum = gov->draw_sum = gov->frame_sum = 0.0;
+    gov->head = 0;
+    gov->count = 0;
+    gov->pending_tick_ms = 0.0;
+    gov->last_draw_us = 0;
 }
 
-/* 主遊戲更新 */
-static void game_update(GameData* gd)
+/*
+ * 每個 tick 排一次重繪, 幀間隔約等於 tick 間隔, 一幀的預算就是 tick_ms;
+ * tick 比螢幕更新還快時, 一幀會累積好幾個 tick, 預算以更新間隔為準.
+ * 預算改變後舊樣本不再可比, 清空視窗重新取樣.
+ */
+static void governor_set_budget(QualityGovernor* gov, guint tick_ms)
 {
-    double now = (double)g_get_monotonic_time() / 1000000.0;
-    double dt = now - gd->last_time;
-    gd->last_time = now;
+    double budget = MAX((double)tick_ms, GOV_MIN_FRAME_MS);
+    if (budget == gov->budget_ms) return;
 
-    if (gd->hp > 0) {
-        /* 玩家移動... */
-        double dx = 0, dy = 0;
-        if (gd->up_pressed)   dy -= 1;
-        if (gd->down_pressed) dy += 1;
-        if (gd->left_pressed) dx -= 1;
-        if (gd->right_pressed)dx += 1;
-        double length = sqrt(dx * dx + dy * dy);
-        if (length > 0) { dx /= length; dy /= length; }
-        gd->player_x += dx * PLAYER_SPEED;
-        gd->player_y += dy * PLAYER_SPEED;
-
-        /* 邊界檢查 */
-        if (gd->player_x < 0) gd->player_x = 0;
-        if (gd->player_x > gd->width)  gd->player_x = gd->width;
-        if (gd->player_y < 0) gd->player_y = 0;
-        if (gd->player_y > gd->height) gd->player_y = gd->height;
-
-        /* 無敵時間 */
-        if (gd->invincible) {
-            gd->invincible_timer -= dt;
-            if (gd->invincible_timer <= 0) {
-                gd->invincible = FALSE;
-                gd->invincible_timer = 0;
-            }
-        }
+    gov->budget_ms = budget;
+    governor_reset_window(gov);
+    g_print("[GOV] budget %.1f ms (tick %u ms)\n", budget, tick_ms);
+}
 
-        /* 開火(若允許) */
-        if (can_player_fire(gd) && gd->space_pressed && gd->bullet_cooldown <= 0) {
-            Bullet* b = bullet_new(gd->player_x, gd->player_y);
-            gd->bullets = g_list_append(gd->bullets, b);
-            gd->bullet_cooldown = BULLET_COOLDOWN;
-        }
-        else {
-            gd->bullet_cooldown -= dt;
-            if (gd->bullet_cooldown < 0) gd->bullet_cooldown = 0;
-        }
+static void governor_free(QualityGovernor* gov)
+{
+    if (gov->hud_surface) {
+        cairo_surface_destroy(gov->hud_surface);
+        gov->hud_surface = NULL;
+    }
+    if (gov->frame_surface) {
+        cairo_surface_destroy(gov->frame_surface);
+        gov->frame_surface = NULL;
+    }
+    if (gov->lowres_surface) {
+        cairo_surface_destroy(gov->lowres_surface);
+        gov->lowres_surface = NULL;
+    }
+}
 
-        /* 子彈移動 & 超出畫面移除 */
-        for (GList* bl = gd->bullets; bl; ) {
-            Bullet* b = (Bullet*)bl->data;
-            GList* next_b = bl->next;
-            b->y -= b->speed;
-            if (b->y < 0) {
-                gd->bullets = g_list_remove(gd->bullets, b);
-                g_free(b);
-            }
-            bl = next_b;
-        }
+/* 取得 w x h 的離屏畫布, 尺寸不符就重建 */
+static cairo_surface_t* governor_surface(cairo_surface_t** slot, int w, int h)
+{
+    if (w < 1) w = 1;
+    if (h < 1) h = 1;
+    if (*slot &&
+        (cairo_image_surface_get_width(*slot) != w ||
+            cairo_image_surface_get_height(*slot) != h)) {
+        cairo_surface_destroy(*slot);
+        *slot = NULL;
+    }
+    if (!*slot) {
+        *slot = cairo_image_surface_create(CAIRO_FORMAT_RGB24, w, h);
+    }
+    return *slot;
+}
 
-        /* 敵機生成 */
-        gd->enemy_spawn_timer += dt;
-        if (gd->enemy_spawn_timer >= ENEMY_SPAWN_INTERVAL) {
-            gd->enemy_spawn_timer = 0;
-            Enemy* e = enemy_new_normal(gd->width, gd->height);
-            gd->enemies = g_list_append(gd->enemies, e);
-        }
+/* 每次 on_draw 結束時記錄一筆: 本幀 tick 耗時 / 繪圖耗時 / 幀間隔 */
+static void governor_record_frame(QualityGovernor* gov, double draw_ms, gint64 now_us)
+{
+    /* 第一幀沒有上一幀可比, 只記下時間點 */
+    if (gov->last_draw_us == 0) {
+        gov->last_draw_us = now_us;
+        gov->pending_tick_ms = 0.0;
+        return;
+    }
+    double frame_ms = (double)(now_us - gov->last_draw_us) / 1000.0;
+    gov->last_draw_us = now_us;
 
-        /* end_game: 此迴圈執行完後再判斷是否要回主選單 */
-        gboolean end_game = FALSE;
-
-        /* 敵機更新 / 碰撞 */
-        for (GList* el = gd->enemies; el; ) {
-            Enemy* e = (Enemy*)el->data;
-            GList* next_e = el->next;
-
-            /* Boss 追玩家 */
-            if (e->is_boss) {
-                double tx = gd->player_x - e->x;
-                double ty = gd->player_y - e->y;
-                double length2 = sqrt(tx * tx + ty * ty);
-                if (length2 > 0) { tx /= length2; ty /= length2; }
-                e->dx = tx; e->dy = ty;
-            }
+    /* 視窗隱藏後再顯示等長時間空檔與繪製成本無關, 整筆丟掉 */
+    if (frame_ms > gov->budget_ms * GOV_FRAME_CAP_RATIO) {
+        gov->pending_tick_ms = 0.0;
+        return;
+    }
 
-            e->x += e->dx * e->speed;
-            e->y += e->dy * e->speed;
+    int i = gov->head;
+    gov->tick_sum += gov->pending_tick_ms - gov->tick_ms[i];
+    gov->draw_sum += draw_ms - gov->draw_ms[i];
+    gov->frame_sum += frame_ms - gov->frame_ms[i];
+    gov->tick_ms[i] = gov->pending_tick_ms;
+    gov->draw_ms[i] = draw_ms;
+    gov->frame_ms[i] = frame_ms;
+    gov->head = (i + 1) % GOV_WINDOW;
+    if (gov->count < GOV_WINDOW) gov->count++;
+    gov->pending_tick_ms = 0.0;
+
+    governor_evaluate(gov);
+}
 
-            double r = e->is_boss ? (ENEMY_SIZE * BOSS_SIZE_RATIO) : ENEMY_SIZE;
+/* 視窗滿了才做決策; 超出預算降一級, 餘裕足夠升一級, 切換後冷卻一段時間 */
+static void governor_evaluate(QualityGovernor* gov)
+{
+    if (gov->hold > 0) {
+        gov->hold--;
+        return;
+    }
+    if (gov->count < GOV_WINDOW) return;
 
-            /* 出界 */
-            if (e->x<0 || e->x>gd->width || e->y<0 || e->y>gd->height) {
-                gd->enemies = g_list_remove(gd->enemies, e);
-                g_free(e);
-                el = next_e;
-                continue;
-            }
+    double avg_tick = gov->tick_sum / gov->count;
+    double avg_draw = gov->draw_sum / gov->count;
+    double avg_frame = gov->frame_sum / gov->count;
+    double avg_work = avg_tick + avg_draw;
 
-            /* 與玩家碰撞 */
-            if (!gd->invincible) {
-                if (circle_collide(gd->player_x, gd->player_y, PLAYER_SIZE,
-                    e->x, e->y, r)) {
-                    gd->hp--;
-                    if (gd->hp <= 0) {
-                        end_game = TRUE;
-                        break;
-                    }
-                    gd->invincible = TRUE;
-                    gd->invincible_timer = INVINCIBLE_TIME;
-                }
-            }
+    QualityLevel old_level = gov->level;
+    const char* reason = NULL;
 
-            /* 子彈打敵機 */
-            if (can_player_fire(gd)) {
-                gboolean destroyed = FALSE;
-                for (GList* bl2 = gd->bullets; bl2; ) {
-                    Bullet* b2 = (Bullet*)bl2->data;
-                    GList* next_bu = bl2->next;
-
-                    if (circle_collide(b2->x, b2->y, BULLET_SIZE, e->x, e->y, r)) {
-                        /* 擊中敵機 */
-                        if (e->is_boss) {
-                            e->boss_hp--;
-                            if (e->boss_hp <= 0) {
-                                gd->score += BOSS_SCORE;
-                                gd->enemies = g_list_remove(gd->enemies, e);
-                                g_free(e);
-                                destroyed = TRUE;
-
-                                /* Boss死 => 結束 */
-                                end_game = TRUE;
-                            }
-                        }
-                        else {
-                            gd->score += ENEMY_SCORE;
-                            gd->enemies = g_list_remove(gd->enemies, e);
-                            g_free(e);
-                            destroyed = TRUE;
-                            if (gd->mode == MODE_CONQUEST) gd->enemies_killed++;
-                        }
-                        gd->bullets = g_list_remove(gd->bullets, b2);
-                        g_free(b2);
-
-                        if (destroyed) break;
-                    }
-                    bl2 = next_bu;
-                }
-                if (destroyed) {
-                    el = next_e;
-                    continue;
-                }
-            }
+    /* 幀間隔過長只在本身工作量也佔了相當比例時才算卡頓;
+     * 工作量很小還是慢 (螢幕 30 Hz 等), 降畫質也沒用 */
+    gboolean stutter = avg_frame > gov->budget_ms * GOV_STUTTER_RATIO &&
+        avg_work > gov->budget_ms * GOV_RESTORE_RATIO;
 
-            el = next_e;
-            if (end_game) break;
+    if (avg_work > gov->budget_ms * GOV_DEGRADE_RATIO) {
+        if (gov->level + 1 < QUALITY_LEVEL_COUNT) {
+            gov->level++;
+            reason = "over budget";
         }
-
-        if (end_game) {
-            game_return_to_menu(gd);
-            return;
+    }
+    else if (stutter) {
+        if (gov->level + 1 < QUALITY_LEVEL_COUNT) {
+            gov->level++;
+            reason = "stutter";
+        }
+    }
+    else if (avg_work < gov->budget_ms * GOV_RESTORE_RATIO) {
+        if (gov->level > QUALITY_FULL) {
+            gov->level--;
+            reason = "headroom";
         }
     }
 
-    /* 模式專用更新 */
-    update_mode_specific(gd, dt);
-}
-
-/* === game_loop === */
-static gboolean game_loop(gpointer user_data)
-{
-    GameData* gd = (GameData*)user_data;
-    if (gd->state == STATE_GAME) {
-        game_update(gd);
-        gtk_widget_queue_draw(gd->page_game);
+    if (reason) {
+        snprintf(gov->last_decision, sizeof(gov->last_decision),
+            "%s -> %s (%s, work %.2f ms, frame %.2f ms)",
+            quality_level_name(old_level), quality_level_name(gov->level),
+            reason, avg_work, avg_frame);
+        g_print("[GOV] %s\n", gov->last_decision);
+
+        /* 新等級重新取樣 */
+        governor_reset_window(gov);
+        gov->last_draw_us = g_get_monotonic_time();
+        gov->hold = GOV_HOLD_FRAMES;
     }
-    return TRUE;
 }
 
-/* === on_draw === */
-static void on_draw(GtkDrawingArea* area, cairo_t* cr,
-    int w, int h, gpointer user_data)
+/* === 繪圖 === */
+/* 背景 / 子彈 / 敵機 / 玩家 (不含文字) */
+static void draw_scene(AppData* ui, cairo_t* cr)
 {
-    GameData* gd = (GameData*)user_data;
+    GameData* gd = &ui->game;
+    QualityLevel level = ui->gov.level;
+
+    if (level >= QUALITY_NO_AA) {
+        cairo_set_antialias(cr, CAIRO_ANTIALIAS_NONE);
+    }
 
     cairo_set_source_rgb(cr, 0, 0, 0);
     cairo_paint(cr);
 
-    /* 子彈(白) */
+    /* 之後都用地圖座標; 只處理鏡頭視野內的東西 */
+    double vx0 = gd->cam_x, vy0 = gd->cam_y;
+    double vx1 = vx0 + WINDOW_WIDTH, vy1 = vy0 + WINDOW_HEIGHT;
+    cairo_translate(cr, -vx0, -vy0);
+
+    /* 區塊格線 + 地圖邊界, 讓捲動看得出來 */
+    int cx0, cy0, cx1, cy1;
+    game_chunk_range(gd, vx0, vy0, vx1, vy1, &cx0, &cy0, &cx1, &cy1);
+    cairo_set_source_rgb(cr, 0.12, 0.12, 0.2);
+    cairo_set_line_width(cr, 1);
+    for (int cx = cx0; cx <= cx1 + 1; cx++) {
+        cairo_move_to(cr, cx * CHUNK_SIZE, vy0);
+        cairo_line_to(cr, cx * CHUNK_SIZE, vy1);
+    }
+    for (int cy = cy0; cy <= cy1 + 1; cy++) {
+        cairo_move_to(cr, vx0, cy * CHUNK_SIZE);
+        cairo_line_to(cr, vx1, cy * CHUNK_SIZE);
+    }
+    cairo_stroke(cr);
+    cairo_set_source_rgb(cr, 0.4, 0.4, 0.6);
+    cairo_set_line_width(cr, 4);
+    cairo_rectangle(cr, 0, 0, gd->width, gd->height);
+    cairo_stroke(cr);
+
+    /* 子彈(白); 特效上限時畫成方塊, 一次 fill 全部.
+     * 子彈離開鏡頭上緣就移除, 不必另外裁切 */
     cairo_set_source_rgb(cr, 1, 1, 1);
-    for (GList* bl = gd->bullets; bl; bl = bl->next) {
-        Bullet* b = (Bullet*)bl->data;
-        cairo_arc(cr, b->x, b->y, BULLET_SIZE, 0, 2 * M_PI);
+    if (level >= QUALITY_FX_CAP) {
+        for (int i = 0; i < gd->bullet_count; i++) {
+            Bullet* b = &gd->bullets[i];
+            cairo_rectangle(cr, b->x - BULLET_SIZE, b->y - BULLET_SIZE,
+                BULLET_SIZE * 2, BULLET_SIZE * 2);
+        }
         cairo_fill(cr);
     }
+    else {
+        for (int i = 0; i < gd->bullet_count; i++) {
+            Bullet* b = &gd->bullets[i];
+            cairo_arc(cr, b->x, b->y, BULLET_SIZE, 0, 2 * M_PI);
+            cairo_fill(cr);
+        }
+    }
 
-    /* 敵機 */
-    for (GList* el = gd->enemies; el; el = el->next) {
-        Enemy* e = (Enemy*)el->data;
-        double r = e->is_boss ? (ENEMY_SIZE * BOSS_SIZE_RATIO) : ENEMY_SIZE;
-        if (e->is_boss) cairo_set_source_rgb(cr, 1, 0.3, 0.3);
-        else           cairo_set_source_rgb(cr, 1, 0, 0);
-
+    /* 敵機: 只走視野涵蓋的區塊 (這些區塊每 tick 都有更新, 位置是最新的) */
+    double r = ENEMY_SIZE;
+    int drawn = 0;
+    game_chunk_range(gd, vx0 - r, vy0 - r, vx1 + r, vy1 + r, &cx0, &cy0, &cx1, &cy1);
+    cairo_set_source_rgb(cr, 1, 0, 0);
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            const Chunk* ch = &gd->chunks[cy * gd->chunk_cols + cx];
+            for (int i = 0; i < ch->count; i++) {
+                Enemy* e = &gd->enemies[ch->items[i]];
+                if (e->x + r < vx0 || e->x - r > vx1 || e->y + r < vy0 || e->y - r > vy1) continue;
+                cairo_arc(cr, e->x, e->y, r, 0, 2 * M_PI);
+                cairo_fill(cr);
+                drawn++;
+            }
+        }
+    }
+    ui->drawn_enemies = drawn;
+
+    /* Boss */
+    r = ENEMY_SIZE * BOSS_SIZE_RATIO;
+    cairo_set_source_rgb(cr, 1, 0.3, 0.3);
+    for (int i = 0; i < gd->boss_count; i++) {
+        Enemy* e = &gd->bosses[i];
+        if (e->x + r < vx0 || e->x - r > vx1 || e->y + r < vy0 || e->y - r > vy1) continue;
         cairo_arc(cr, e->x, e->y, r, 0, 2 * M_PI);
         cairo_fill(cr);
     }
 
     /* 玩家 */
     if (gd->hp > 0) {
-        if (gd->invincible) {
+        if (gd->invincible && level < QUALITY_FX_CAP) {
             static gboolean toggle = FALSE;
             toggle = !toggle;
             if (toggle) cairo_set_source_rgb(cr, 1, 1, 0);
             else       cairo_set_source_rgb(cr, 1, 0.5, 0);
         }
+        else if (gd->invincible) {
+            cairo_set_source_rgb(cr, 1, 1, 0);
+        }
         else {
             cairo_set_source_rgb(cr, 0, 1, 0);
         }
         cairo_arc(cr, gd->player_x, gd->player_y, PLAYER_SIZE, 0, 2 * M_PI);
         cairo_fill(cr);
     }
+}
 
-    /* 文字顯示 */
-    cairo_set_source_rgb(cr, 1, 1, 1);
-    cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
-    cairo_set_font_size(cr, 20);
-
+/* 文字顯示; 簡化模式下先畫到快取圖, 文字有變才重畫 */
+static void draw_hud(AppData* ui, cairo_t* cr, int w)
+{
+    GameData* gd = &ui->game;
     char info[128];
     switch (gd->mode) {
     case MODE_DODGE:
@@ -768,8 +961,151 @@ static void on_draw(GtkDrawingArea* area, cairo_t* cr,
             gd->hp, gd->score, gd->enemies_killed);
         break;
     }
-    cairo_move_to(cr, 10, 30);
-    cairo_show_text(cr, info);
+
+    if (ui->gov.level < QUALITY_SIMPLE_HUD) {
+        cairo_set_source_rgb(cr, 1, 1, 1);
+        cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
+        cairo_set_font_size(cr, 20);
+        cairo_move_to(cr, 10, 30);
+        cairo_show_text(cr, info);
+        return;
+    }
+
+    QualityGovernor* gov = &ui->gov;
+    if (gov->hud_surface && cairo_image_surface_get_width(gov->hud_surface) != w) {
+        cairo_surface_destroy(gov->hud_surface);
+        gov->hud_surface = NULL;
+    }
+    if (!gov->hud_surface) {
+        gov->hud_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, w, HUD_HEIGHT);
+        gov->hud_text[0] = '\0';
+    }
+    if (strcmp(gov->hud_text, info) != 0) {
+        cairo_t* hcr = cairo_create(gov->hud_surface);
+        cairo_set_operator(hcr, CAIRO_OPERATOR_CLEAR);
+        cairo_paint(hcr);
+        cairo_set_operator(hcr, CAIRO_OPERATOR_OVER);
+        cairo_set_source_rgb(hcr, 1, 1, 1);
+        cairo_select_font_face(hcr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
+        cairo_set_font_size(hcr, 20);
+        cairo_move_to(hcr, 10, 30);
+        cairo_show_text(hcr, info);
+        cairo_destroy(hcr);
+        snprintf(gov->hud_text, sizeof(gov->hud_text), "%s", info);
+    }
+    cairo_set_source_surface(cr, gov->hud_surface, 0, 0);
+    cairo_paint(cr);
+}
+
+/* F3: 顯示畫質等級與滾動平均 */
+static void draw_debug_overlay(AppData* ui, cairo_t* cr)
+{
+    QualityGovernor* gov = &ui->gov;
+    double n = gov->count > 0 ? gov->count : 1;
+    char line[160];
+
+    cairo_set_source_rgb(cr, 0, 1, 1);
+    cairo_select_font_face(cr, "Monospace", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_size(cr, 12);
+
+    snprintf(line, sizeof(line),
+        "GOV L%d %s | tick %.2f ms | draw %.2f ms | frame %.2f ms | budget %.1f ms",
+        gov->level, quality_level_name(gov->level),
+        gov->tick_sum / n, gov->draw_sum / n, gov->frame_sum / n, gov->budget_ms);
+    cairo_move_to(cr, 10, HUD_HEIGHT + 15);
+    cairo_show_text(cr, line);
+
+    snprintf(line, sizeof(line), "last: %s", gov->last_decision);
+    cairo_move_to(cr, 10, HUD_HEIGHT + 30);
+    cairo_show_text(cr, line);
+
+    snprintf(line, sizeof(line), "cfg: tick %d ms | parse %.3f ms | apply %.3f ms",
+        ui->tuning->game_tick_ms, ui->cfg_parse_ms, ui->cfg_apply_ms);
+    cairo_move_to(cr, 10, HUD_HEIGHT + 45);
+    cairo_show_text(cr, line);
+
+    GameData* gd = &ui->game;
+    snprintf(line, sizeof(line), "world %dx%d | cam %.0f,%.0f | chunks %dx%d | enemies drawn %d / %d",
+        gd->width, gd->height, gd->cam_x, gd->cam_y, gd->chunk_cols, gd->chunk_rows,
+        ui->drawn_enemies, gd->enemy_count);
+    cairo_move_to(cr, 10, HUD_HEIGHT + 60);
+    cairo_show_text(cr, line);
+
+    if (ui->audio) {
+        AudioStats st;
+        audio_get_stats(ui->audio, &st);
+        snprintf(line, sizeof(line), "audio %s | block avg %.3f ms max %.3f ms | underruns %u | dropped %u | voices %u",
+            audio_sink_name(ui->audio), st.block_avg_ms, st.block_max_ms,
+            st.underruns, st.dropped_events, st.active_voices);
+        cairo_move_to(cr, 10, HUD_HEIGHT + 75);
+        cairo_show_text(cr, line);
+    }
+
+    if (ui->frame_export) {
+        FrameExportStats st;
+        frame_export_get_stats(ui->frame_export, &st);
+        snprintf(line, sizeof(line), "export %u frames | publish avg %.2f us max %.0f us | truncated %u",
+            st.frames, st.publish_avg_us, st.publish_max_us, st.truncated);
+        cairo_move_to(cr, 10, HUD_HEIGHT + 90);
+        cairo_show_text(cr, line);
+    }
+}
+
+/* === on_draw === */
+static void on_draw(GtkDrawingArea* area, cairo_t* cr,
+    int w, int h, gpointer user_data)
+{
+    AppData* ui = (AppData*)user_data;
+    QualityGovernor* gov = &ui->gov;
+    gint64 t0 = g_get_monotonic_time();
+
+    /*
+     * GTK4 的 draw func 只是把 cairo 指令錄成 render node, 真正的光柵化
+     * 發生在之後的 GSK 階段. 為了讓每一級量到的都是實際繪製成本,
+     * 一律先畫進原解析度的 image surface, 最後再整張貼到 cr.
+     */
+    cairo_surface_t* frame = governor_surface(&gov->frame_surface, w, h);
+    cairo_t* fcr = cairo_create(frame);
+
+    if (gov->level >= QUALITY_LOW_RES) {
+        /* 縮小畫到離屏畫布, 再放大貼回 */
+        cairo_surface_t* low = governor_surface(&gov->lowres_surface,
+            (int)(w * LOWRES_SCALE), (int)(h * LOWRES_SCALE));
+
+        cairo_t* lcr = cairo_create(low);
+        cairo_scale(lcr, LOWRES_SCALE, LOWRES_SCALE);
+        draw_scene(ui, lcr);
+        cairo_destroy(lcr);
+
+        cairo_save(fcr);
+        cairo_scale(fcr, 1.0 / LOWRES_SCALE, 1.0 / LOWRES_SCALE);
+        cairo_set_source_surface(fcr, low, 0, 0);
+        cairo_pattern_set_filter(cairo_get_source(fcr), CAIRO_FILTER_FAST);
+        cairo_paint(fcr);
+        cairo_restore(fcr);
+    }
+    else {
+        cairo_save(fcr);
+        draw_scene(ui, fcr);
+        cairo_restore(fcr);
+    }
+
+    /* HUD 維持原解析度, 確保文字清楚 */
+    draw_hud(ui, fcr, w);
+
+    if (gov->show_overlay) {
+        draw_debug_overlay(ui, fcr);
+    }
+
+    cairo_destroy(fcr);
+    cairo_surface_flush(frame);
+
+    gint64 t1 = g_get_monotonic_time();
+
+    cairo_set_source_surface(cr, frame, 0, 0);
+    cairo_paint(cr);
+
+    governor_record_frame(gov, (double)(t1 - t0) / 1000.0, t1);
 }
 
 /* === 鍵盤事件 === */
@@ -777,7 +1113,8 @@ static gboolean on_key_press(GtkEventControllerKey* ctrl,
     guint keyval, guint keycode,
     GdkModifierType state, gpointer user_data)
 {
-    GameData* gd = (GameData*)user_data;
+    AppData* ui = (AppData*)user_data;
+    GameData* gd = &ui->game;
     switch (keyval) {
     case GDK_KEY_w:
     case GDK_KEY_Up:    gd->up_pressed = TRUE;    break;
@@ -788,6 +1125,7 @@ static gboolean on_key_press(GtkEventControllerKey* ctrl,
     case GDK_KEY_d:
     case GDK_KEY_Right: gd->right_pressed = TRUE; break;
     case GDK_KEY_space: gd->space_pressed = TRUE; break;
+    case GDK_KEY_F3:    ui->gov.show_overlay = !ui->gov.show_overlay; break;
     default: break;
     }
     return TRUE;
@@ -797,7 +1135,8 @@ static gboolean on_key_release(GtkEventControllerKey* ctrl,
     guint keyval, guint keycode,
     GdkModifierType state, gpointer user_data)
 {
-    GameData* gd = (GameData*)user_data;
+    AppData* ui = (AppData*)user_data;
+    GameData* gd = &ui->game;
     switch (keyval) {
     case GDK_KEY_w:
     case GDK_KEY_Up:    gd->up_pressed = FALSE;    break;
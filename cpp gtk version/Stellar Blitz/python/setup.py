@@ -0,0 +1,55 @@
+# 建置: python setup.py build_ext --inplace
+# 需要 GLib 開發檔 (Linux: pkg-config glib-2.0; Windows: 與 vcxproj 相同的 C:/gtk-build).
+import os
+import shlex
+import subprocess
+import sys
+
+from setuptools import Extension, setup
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ENGINE_DIR = os.path.join(HERE, "..", "Stellar Blitz")
+GTK_BUILD = "C:/gtk-build/gtk/x64/release"
+
+
+def glib_flags():
+    try:
+        cflags = subprocess.check_output(["pkg-config", "--cflags", "glib-2.0"], text=True)
+        libs = subprocess.check_output(["pkg-config", "--libs", "glib-2.0"], text=True)
+    except (OSError, subprocess.CalledProcessError):
+        if sys.platform == "win32":
+            return dict(
+                include_dirs=[GTK_BUILD + "/include/glib-2.0", GTK_BUILD + "/lib/glib-2.0/include"],
+                library_dirs=[GTK_BUILD + "/lib"],
+                libraries=["glib-2.0"],
+            )
+        raise
+    flags = dict(include_dirs=[], library_dirs=[], libraries=[], extra_compile_args=[])
+    for tok in shlex.split(cflags):
+        if tok.startswith("-I"):
+            flags["include_dirs"].append(tok[2:])
+        else:
+            flags["extra_compile_args"].append(tok)
+    for tok in shlex.split(libs):
+        if tok.startswith("-L"):
+            flags["library_dirs"].append(tok[2:])
+        elif tok.startswith("-l"):
+            flags["libraries"].append(tok[2:])
+    return flags
+
+
+flags = glib_flags()
+flags["include_dirs"].append(ENGINE_DIR)
+
+setup(
+    name="stellar_engine",
+    version="0.1",
+    description="Headless Stellar Blitz engine for batch simulation",
+    ext_modules=[
+        Extension(
+            "stellar_engine",
+            sources=["stellar_engine.c", os.path.join(ENGINE_DIR, "game.c")],
+            **flags,
+        )
+    ],
+)
@@ -0,0 +1,493 @@
+﻿/* === stellar_engine: game.c 的 Python 擴充模組 ===
+ * 讓企劃用 Python 跑大量 tick 做平衡測試, 不必經過 GTK 或逐一建立 Python 物件.
+ *
+ *   import stellar_engine as se
+ *   g = se.Game(se.MODE_CONQUEST, seed=1, enemy_spawn_interval=0.5)
+ *   g.step(60 * 60, se.INPUT_FIRE | se.INPUT_LEFT)
+ *   pos = numpy.asarray(g.enemies)      # (n, 2) float64, 不複製
+ *
+ * 實體位置以 buffer protocol 直接指向 C 陣列 (唯讀). 列數是取得當下的數量,
+ * 每次 step 之後請重新取得. enemies 包含整張地圖的敵機: 引擎內遠方的敵機
+ * 最多可能落後 WAKE_WHEEL_SIZE-1 個 tick 才補座標, step() 結束前會呼叫
+ * game_sync_positions 全部補到目前 tick, 所以 step 之後讀到的都是當下位置. */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <stddef.h>
+
+#include "game.h"
+
+/* step() 的輸入位元 */
+#define INPUT_UP     0x01
+#define INPUT_DOWN   0x02
+#define INPUT_LEFT   0x04
+#define INPUT_RIGHT  0x08
+#define INPUT_FIRE   0x10
+
+typedef enum {
+    VIEW_ENEMIES,
+    VIEW_BULLETS,
+    VIEW_BOSSES
+} ViewKind;
+
+/* Game: 一局模擬, 自帶一份 Tuning */
+typedef struct {
+    PyObject_HEAD
+    GameData game;
+    Tuning tuning;
+    Py_ssize_t exports;     /* 尚未釋放的實體 buffer 數 */
+} GameObject;
+
+/* EntityView: 某一類實體位置的快照視圖 (資料即時, 列數固定) */
+typedef struct {
+    PyObject_HEAD
+    GameObject* owner;
+    char* buf;
+    Py_ssize_t shape[2];
+    Py_ssize_t strides[2];
+} EntityViewObject;
+
+static PyTypeObject GameType;
+static PyTypeObject EntityViewType;
+
+/* === Tuning 關鍵字參數 ===
+ * 欄位與範圍沿用 game.c 的 tuning_fields (與 stellar.ini 相同);
+ * ini 超出範圍會夾回, 這裡直接拒絕, 免得腳本以為設成了別的值 */
+static int tuning_set_field(Tuning* t, PyObject* key, PyObject* value)
+{
+    const char* name = PyUnicode_AsUTF8(key);
+    if (!name) return -1;
+
+    for (int i = 0; i < tuning_field_count; i++) {
+        const TuningField* f = &tuning_fields[i];
+        if (strcmp(f->name, name) != 0) continue;
+
+        if (f->is_int) {
+            /* 先以 long long 取值, 超過 int 的也會落在範圍外而不是被截斷 */
+            int overflow = 0;
+            long long v = PyLong_AsLongLongAndOverflow(value, &overflow);
+            if (v == -1 && PyErr_Occurred()) return -1;
+            if (overflow) {
+                PyErr_Format(PyExc_ValueError, "%s=%R out of range [%d, %d]",
+                    name, value, (int)f->min, (int)f->max);
+                return -1;
+            }
+            if (v < (long long)f->min || v > (long long)f->max) {
+                PyErr_Format(PyExc_ValueError, "%s=%lld out of range [%d, %d]",
+                    name, v, (int)f->min, (int)f->max);
+                return -1;
+            }
+            *(int*)((char*)t + f->offset) = (int)v;
+        }
+        else {
+            double v = PyFloat_AsDouble(value);
+            if (v == -1.0 && PyErr_Occurred()) return -1;
+            if (!(v >= f->min && v <= f->max)) {
+                char msg[128];
+                snprintf(msg, sizeof(msg), "%s=%g out of range [%g, %g]", name, v, f->min, f->max);
+                PyErr_SetString(PyExc_ValueError, msg);
+                return -1;
+            }
+            *(double*)((char*)t + f->offset) = v;
+        }
+        return 0;
+    }
+    PyErr_Format(PyExc_TypeError, "unknown tuning parameter '%s'", name);
+    return -1;
+}
+
+static int parse_mode(int mode)
+{
+    if (mode < MODE_DODGE || mode > MODE_CONQUEST) {
+        PyErr_SetString(PyExc_ValueError, "mode must be MODE_DODGE, MODE_TIME_ATTACK or MODE_CONQUEST");
+        return -1;
+    }
+    return 0;
+}
+
+/* === Game === */
+static int Game_init(GameObject* self, PyObject* args, PyObject* kwds)
+{
+    int mode = MODE_DODGE;
+    PyObject* seed = Py_None;
+    const char* config = NULL;
+
+    /* 已匯出的 view 指著舊陣列: 一開始就拒絕, 不動任何狀態 */
+    if (self->exports > 0) {
+        PyErr_SetString(PyExc_BufferError, "cannot re-initialize a Game with exported views");
+        return -1;
+    }
+
+    /* 位置參數: mode; 關鍵字: seed, config, 以及任何 Tuning 欄位 */
+    if (!PyArg_ParseTuple(args, "|i:Game", &mode)) return -1;
+    if (parse_mode(mode) < 0) return -1;
+
+    /* 先解析到區域變數, 全部通過才寫回 self, 失敗時物件維持原狀 */
+    Tuning tuning;
+    tuning_set_defaults(&tuning);
+
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t pos = 0;
+    if (kwds) {
+        /* config 先處理, 其他欄位覆寫在它之上 */
+        PyObject* cfg = PyDict_GetItemString(kwds, "config");
+        if (cfg && cfg != Py_None) {
+            config = PyUnicode_AsUTF8(cfg);
+            if (!config) return -1;
+
+            GError* err = NULL;
+            if (!tuning_load(config, &tuning, &err)) {
+                PyErr_Format(PyExc_OSError, "%s: %s", config, err->message);
+                g_error_free(err);
+                return -1;
+            }
+        }
+        while (PyDict_Next(kwds, &pos, &key, &value)) {
+            if (PyUnicode_CompareWithASCIIString(key, "config") == 0) continue;
+            if (PyUnicode_CompareWithASCIIString(key, "seed") == 0) {
+                seed = value;
+                continue;
+            }
+            if (tuning_set_field(&tuning, key, value) < 0) return -1;
+        }
+    }
+
+    unsigned long s = 0;
+    if (seed != Py_None) {
+        s = PyLong_AsUnsignedLongMask(seed);
+        if (PyErr_Occurred()) return -1;
+    }
+
+    self->tuning = tuning;
+    if (seed != Py_None) srand((unsigned int)s);
+
+    game_data_free(&self->game);
+    game_data_init(&self->game, &self->tuning);
+    self->game.mode = (GameMode)mode;
+    game_reset(&self->game);
+    return 0;
+}
+
+static void Game_dealloc(GameObject* self)
+{
+    game_data_free(&self->game);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+PyDoc_STRVAR(Game_reset_doc,
+"reset(mode=None, seed=None)\n\n"
+"Start a new round. mode defaults to the current mode; seed reseeds the C rand().");
+
+static PyObject* Game_reset(GameObject* self, PyObject* args, PyObject* kwds)
+{
+    static char* kwlist[] = { "mode", "seed", NULL };
+    PyObject* mode_obj = Py_None;
+    PyObject* seed = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OO:reset", kwlist, &mode_obj, &seed)) {
+        return NULL;
+    }
+    if (mode_obj != Py_None) {
+        long mode = PyLong_AsLong(mode_obj);
+        if (mode == -1 && PyErr_Occurred()) return NULL;
+        if (parse_mode((int)mode) < 0) return NULL;
+        self->game.mode = (GameMode)mode;
+    }
+    if (seed != Py_None) {
+        unsigned long s = PyLong_AsUnsignedLongMask(seed);
+        if (PyErr_Occurred()) return NULL;
+        srand((unsigned int)s);
+    }
+    game_reset(&self->game);
+    Py_RETURN_NONE;
+}
+
+static void apply_input(GameData* gd, unsigned int bits)
+{
+    gd->up_pressed = (bits & INPUT_UP) != 0;
+    gd->down_pressed = (bits & INPUT_DOWN) != 0;
+    gd->left_pressed = (bits & INPUT_LEFT) != 0;
+    gd->right_pressed = (bits & INPUT_RIGHT) != 0;
+    gd->space_pressed = (bits & INPUT_FIRE) != 0;
+}
+
+PyDoc_STRVAR(Game_step_doc,
+"step(n_ticks, inputs=0) -> int\n\n"
+"Advance up to n_ticks fixed ticks (game_tick_ms each).\n"
+"inputs is either an int of INPUT_* bits held for every tick, or a bytes-like\n"
+"object (e.g. a uint8 numpy array) with one INPUT_* byte per tick.\n"
+"Stops early when the round ends; returns the number of ticks run.\n"
+"Afterwards every position in enemies is current as of the last tick.");
+
+static PyObject* Game_step(GameObject* self, PyObject* args)
+{
+    Py_ssize_t n_ticks;
+    PyObject* inputs = NULL;
+    if (!PyArg_ParseTuple(args, "n|O:step", &n_ticks, &inputs)) return NULL;
+    if (n_ticks < 0) {
+        PyErr_SetString(PyExc_ValueError, "n_ticks must be >= 0");
+        return NULL;
+    }
+
+    GameData* gd = &self->game;
+    double dt = self->tuning.game_tick_ms / 1000.0;
+    Py_ssize_t ran = 0;
+
+    if (inputs == NULL || PyLong_Check(inputs)) {
+        unsigned int bits = inputs ? (unsigned int)PyLong_AsUnsignedLongMask(inputs) : 0;
+        if (PyErr_Occurred()) return NULL;
+        apply_input(gd, bits);
+        while (ran < n_ticks && gd->state == STATE_GAME) {
+            game_step(gd, dt);
+            ran++;
+        }
+    }
+    else {
+        Py_buffer view;
+        if (PyObject_GetBuffer(inputs, &view, PyBUF_SIMPLE) < 0) return NULL;
+        if (view.len < n_ticks) {
+            PyBuffer_Release(&view);
+            PyErr_Format(PyExc_ValueError, "inputs has %zd entries, need %zd", view.len, n_ticks);
+            return NULL;
+        }
+        const unsigned char* bits = (const unsigned char*)view.buf;
+        while (ran < n_ticks && gd->state == STATE_GAME) {
+            apply_input(gd, bits[ran]);
+            game_step(gd, dt);
+            ran++;
+        }
+        PyBuffer_Release(&view);
+    }
+
+    /* 整批跑完才補一次遠方敵機的座標, 不必每 tick 做 */
+    game_sync_positions(gd);
+    return PyLong_FromSsize_t(ran);
+}
+
+/* 建立某類實體的視圖, 以 memoryview 回傳 */
+static PyObject* Game_make_view(GameObject* self, ViewKind kind)
+{
+    EntityViewObject* v = PyObject_New(EntityViewObject, &EntityViewType);
+    if (!v) return NULL;
+
+    GameData* gd = &self->game;
+    Py_INCREF(self);
+    v->owner = self;
+    v->shape[1] = 2;
+    v->strides[1] = sizeof(double);
+    switch (kind) {
+    case VIEW_ENEMIES:
+        v->buf = (char*)&gd->enemies[0].x;
+        v->shape[0] = gd->enemy_count;
+        v->strides[0] = sizeof(Enemy);
+        break;
+    case VIEW_BULLETS:
+        v->buf = (char*)&gd->bullets[0].x;
+        v->shape[0] = gd->bullet_count;
+        v->strides[0] = sizeof(Bullet);
+        break;
+    case VIEW_BOSSES:
+        v->buf = (char*)&gd->bosses[0].x;
+        v->shape[0] = gd->boss_count;
+        v->strides[0] = sizeof(Enemy);
+        break;
+    }
+
+    PyObject* mv = PyMemoryView_FromObject((PyObject*)v);
+    Py_DECREF(v);
+    return mv;
+}
+
+static PyObject* Game_get_enemies(GameObject* self, void* closure) { return Game_make_view(self, VIEW_ENEMIES); }
+static PyObject* Game_get_bullets(GameObject* self, void* closure) { return Game_make_view(self, VIEW_BULLETS); }
+static PyObject* Game_get_bosses(GameObject* self, void* closure) { return Game_make_view(self, VIEW_BOSSES); }
+
+static PyObject* Game_get_player(GameObject* self, void* closure)
+{
+    return Py_BuildValue("(dd)", self->game.player_x, self->game.player_y);
+}
+
+static PyObject* Game_get_camera(GameObject* self, void* closure)
+{
+    return Py_BuildValue("(dd)", self->game.cam_x, self->game.cam_y);
+}
+
+static PyObject* Game_get_running(GameObject* self, void* closure)
+{
+    return PyBool_FromLong(self->game.state == STATE_GAME);
+}
+
+static PyObject* Game_get_time_left(GameObject* self, void* closure)
+{
+    return PyFloat_FromDouble(self->game.time_left);
+}
+
+static PyObject* Game_get_tuning(GameObject* self, void* closure)
+{
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+    for (int i = 0; i < tuning_field_count; i++) {
+        const TuningField* f = &tuning_fields[i];
+        const char* p = (const char*)&self->tuning + f->offset;
+        PyObject* v = f->is_int ? PyLong_FromLong(*(const int*)p) : PyFloat_FromDouble(*(const double*)p);
+        if (!v || PyDict_SetItemString(d, f->name, v) < 0) {
+            Py_XDECREF(v);
+            Py_DECREF(d);
+            return NULL;
+        }
+        Py_DECREF(v);
+    }
+    return d;
+}
+
+#define GAME_INT_GETTER(field)                                          \
+    static PyObject* Game_get_##field(GameObject* self, void* closure)  \
+    {                                                                   \
+        return PyLong_FromLong(self->game.field);                       \
+    }
+GAME_INT_GETTER(mode)
+GAME_INT_GETTER(hp)
+GAME_INT_GETTER(score)
+GAME_INT_GETTER(enemies_killed)
+GAME_INT_GETTER(enemy_count)
+GAME_INT_GETTER(bullet_count)
+GAME_INT_GETTER(boss_count)
+#undef GAME_INT_GETTER
+
+static PyMethodDef Game_methods[] = {
+    { "reset", (PyCFunction)(void(*)(void))Game_reset, METH_VARARGS | METH_KEYWORDS, Game_reset_doc },
+    { "step", (PyCFunction)Game_step, METH_VARARGS, Game_step_doc },
+    { NULL }
+};
+
+static PyGetSetDef Game_getset[] = {
+    { "enemies", (getter)Game_get_enemies, NULL, "(n, 2) float64 view of common enemy positions, current as of the last step()", NULL },
+    { "bullets", (getter)Game_get_bullets, NULL, "(n, 2) float64 view of bullet positions", NULL },
+    { "bosses", (getter)Game_get_bosses, NULL, "(n, 2) float64 view of boss positions", NULL },
+    { "player", (getter)Game_get_player, NULL, "(x, y) of the player", NULL },
+    { "camera", (getter)Game_get_camera, NULL, "(x, y) of the camera's top-left corner", NULL },
+    { "running", (getter)Game_get_running, NULL, "False once the round has ended", NULL },
+    { "time_left", (getter)Game_get_time_left, NULL, "Time Attack seconds left", NULL },
+    { "tuning", (getter)Game_get_tuning, NULL, "dict of the tuning values in use", NULL },
+    { "mode", (getter)Game_get_mode, NULL, NULL, NULL },
+    { "hp", (getter)Game_get_hp, NULL, NULL, NULL },
+    { "score", (getter)Game_get_score, NULL, NULL, NULL },
+    { "kills", (getter)Game_get_enemies_killed, NULL, NULL, NULL },
+    { "enemy_count", (getter)Game_get_enemy_count, NULL, NULL, NULL },
+    { "bullet_count", (getter)Game_get_bullet_count, NULL, NULL, NULL },
+    { "boss_count", (getter)Game_get_boss_count, NULL, NULL, NULL },
+    { NULL }
+};
+
+PyDoc_STRVAR(Game_doc,
+"Game(mode=MODE_DODGE, *, seed=None, config=None, **tuning)\n\n"
+"One headless Stellar Blitz round. config loads a stellar.ini; any Tuning\n"
+"field (player_speed, enemy_spawn_interval, max_enemies, ...) may be\n"
+"overridden by keyword. seed reseeds the process-wide C rand().");
+
+static PyTypeObject GameType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "stellar_engine.Game",
+    .tp_basicsize = sizeof(GameObject),
+    .tp_dealloc = (destructor)Game_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = Game_doc,
+    .tp_methods = Game_methods,
+    .tp_getset = Game_getset,
+    .tp_init = (initproc)Game_init,
+    .tp_new = PyType_GenericNew,
+};
+
+/* === EntityView (buffer protocol) === */
+static int EntityView_getbuffer(EntityViewObject* self, Py_buffer* view, int flags)
+{
+    if (flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "entity views are read-only");
+        return -1;
+    }
+    if ((flags & PyBUF_STRIDES) != PyBUF_STRIDES) {
+        PyErr_SetString(PyExc_BufferError, "entity views are strided; request PyBUF_STRIDES");
+        return -1;
+    }
+
+    view->obj = (PyObject*)self;
+    Py_INCREF(self);
+    view->buf = self->buf;
+    view->len = self->shape[0] * self->shape[1] * (Py_ssize_t)sizeof(double);
+    view->readonly = 1;
+    view->itemsize = sizeof(double);
+    view->format = (flags & PyBUF_FORMAT) ? "d" : NULL;
+    view->ndim = 2;
+    view->shape = self->shape;
+    view->strides = self->strides;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+
+    self->owner->exports++;
+    return 0;
+}
+
+static void EntityView_releasebuffer(EntityViewObject* self, Py_buffer* view)
+{
+    self->owner->exports--;
+}
+
+static void EntityView_dealloc(EntityViewObject* self)
+{
+    Py_XDECREF(self->owner);
+    PyObject_Free(self);
+}
+
+static PyBufferProcs EntityView_as_buffer = {
+    (getbufferproc)EntityView_getbuffer,
+    (releasebufferproc)EntityView_releasebuffer,
+};
+
+static PyTypeObject EntityViewType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "stellar_engine.EntityView",
+    .tp_basicsize = sizeof(EntityViewObject),
+    .tp_dealloc = (destructor)EntityView_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_as_buffer = &EntityView_as_buffer,
+};
+
+/* === 模組 === */
+static struct PyModuleDef stellar_engine_module = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "stellar_engine",
+    .m_doc = "Headless Stellar Blitz engine (game.c) for batch simulation.",
+    .m_size = -1,
+};
+
+PyMODINIT_FUNC PyInit_stellar_engine(void)
+{
+    if (PyType_Ready(&GameType) < 0) return NULL;
+    if (PyType_Ready(&EntityViewType) < 0) return NULL;
+
+    PyObject* m = PyModule_Create(&stellar_engine_module);
+    if (!m) return NULL;
+
+    Py_INCREF(&GameType);
+    if (PyModule_AddObject(m, "Game", (PyObject*)&GameType) < 0) {
+        Py_DECREF(&GameType);
+        Py_DECREF(m);
+        return NULL;
+    }
+
+    if (PyModule_AddIntConstant(m, "MODE_DODGE", MODE_DODGE) < 0 ||
+        PyModule_AddIntConstant(m, "MODE_TIME_ATTACK", MODE_TIME_ATTACK) < 0 ||
+        PyModule_AddIntConstant(m, "MODE_CONQUEST", MODE_CONQUEST) < 0 ||
+        PyModule_AddIntConstant(m, "INPUT_UP", INPUT_UP) < 0 ||
+        PyModule_AddIntConstant(m, "INPUT_DOWN", INPUT_DOWN) < 0 ||
+        PyModule_AddIntConstant(m, "INPUT_LEFT", INPUT_LEFT) < 0 ||
+        PyModule_AddIntConstant(m, "INPUT_RIGHT", INPUT_RIGHT) < 0 ||
+        PyModule_AddIntConstant(m, "INPUT_FIRE", INPUT_FIRE) < 0 ||
+        PyModule_AddIntConstant(m, "VIEW_WIDTH", WINDOW_WIDTH) < 0 ||
+        PyModule_AddIntConstant(m, "VIEW_HEIGHT", WINDOW_HEIGHT) < 0 ||
+        PyModule_AddIntConstant(m, "CHUNK_SIZE", CHUNK_SIZE) < 0) {
+        Py_DECREF(m);
+        return NULL;
+    }
+    return m;
+}
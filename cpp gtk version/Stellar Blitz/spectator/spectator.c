@@ -0,0 +1,265 @@
+﻿/* === spectator: 讀取遊戲輸出的畫面快照 ===
+ * 從共享記憶體 (格式見 ../Stellar Blitz/frame_shm.h) 讀最新一幀, 每秒印出統計,
+ * 可選擇把讀到的快照錄成檔案. 只讀不寫, 讀太慢就跳幀, 不會拖慢遊戲.
+ *
+ *   建置: cc -O2 -o spectator spectator.c        (舊版 glibc 需加 -lrt)
+ *         Windows 用方案裡的 spectator 專案 (spectator.vcxproj)
+ *   遊戲: STELLAR_EXPORT=1 ./StellarBlitz   或   ./StellarBlitz --export-test 10
+ *   讀取: ./spectator [-n 秒數] [-s 每幀額外延遲 ms] [-o 錄影檔]
+ *
+ * POSIX 用 shm_open, Windows 用同名的 file mapping (OpenFileMappingA), 格式相同.
+ * Windows 上遊戲與 spectator 需在同一個登入工作階段 (名稱在 Local\ 之下). */
+
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS
+#else
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <mmsystem.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "../Stellar Blitz/frame_shm.h"
+
+#define POLL_US         500     /* 沒有新幀時的等待間隔 */
+#define REPORT_SEC      1.0
+
+typedef struct {
+    unsigned read;
+    unsigned dropped;       /* 讀取端太慢而跳過的幀 */
+    unsigned torn;          /* 讀到一半被覆寫, 丟掉重讀 */
+    unsigned restarts;
+    double lag_sum_ms;      /* 發布到讀完的延遲 */
+    double lag_max_ms;
+} SpectatorStats;
+
+/* 與遊戲的 g_get_monotonic_time 同一個時鐘 (Windows 上 GLib 也用 QueryPerformanceCounter) */
+static int64_t now_us(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER t;
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (int64_t)(t.QuadPart / freq.QuadPart * 1000000 +
+        t.QuadPart % freq.QuadPart * 1000000 / freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+/* Windows 只能睡整數 ms (main 裡已把計時器解析度調到 1 ms) */
+static void sleep_us(long us)
+{
+#ifdef _WIN32
+    Sleep((DWORD)((us + 999) / 1000));
+#else
+    struct timespec ts = { us / 1000000, (us % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+static void shm_unmap(const void* p)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(p);
+#else
+    munmap((void*)p, sizeof(FrameShm));
+#endif
+}
+
+/* 遊戲還沒開 (或已結束) 回傳 NULL */
+static const FrameShm* shm_attach(void)
+{
+#ifdef _WIN32
+    /* view 會保住 mapping, handle 可以先關 */
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, FRAME_SHM_NAME);
+    if (!mapping) return NULL;
+
+    void* p = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(FrameShm));
+    CloseHandle(mapping);
+    if (!p) return NULL;
+#else
+    int fd = shm_open(FRAME_SHM_NAME, O_RDONLY, 0);
+    if (fd < 0) return NULL;
+
+    void* p = mmap(NULL, sizeof(FrameShm), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return NULL;
+#endif
+
+    const FrameShm* shm = (const FrameShm*)p;
+    if (shm->magic != FRAME_SHM_MAGIC) {
+        shm_unmap(p);
+        return NULL;
+    }
+    FRAME_SHM_FENCE();
+    if (shm->version != FRAME_SHM_VERSION || shm->slot_count != FRAME_SHM_SLOTS ||
+        shm->slot_size != sizeof(FrameSlot)) {
+        fprintf(stderr, "[SPECTATOR] layout mismatch (version %u), rebuild spectator\n", shm->version);
+        exit(1);
+    }
+    return shm;
+}
+
+static void shm_detach(const FrameShm* shm)
+{
+    shm_unmap(shm);
+}
+
+/* 讀 frame 這一幀到 out (seqlock); 被覆寫或寫到一半回傳 0 */
+static int slot_read(const FrameShm* shm, uint32_t frame, FrameSlot* out)
+{
+    const FrameSlot* slot = &shm->slots[frame % FRAME_SHM_SLOTS];
+    uint32_t seq = 2 * frame;
+
+    if (slot->seq != seq) return 0;
+    FRAME_SHM_FENCE();
+
+    /* 固定欄位 + 用到的實體; 數量可能是半途的值, 先夾在上限內 */
+    memcpy(out, slot, offsetof(FrameSlot, entities));
+    size_t n = (size_t)out->n_enemies + out->n_bullets + out->n_bosses;
+    if (n > FRAME_SHM_MAX_ENTITIES) n = FRAME_SHM_MAX_ENTITIES;
+    memcpy(out->entities, slot->entities, n * sizeof(FrameEntity));
+
+    FRAME_SHM_FENCE();
+    return slot->seq == seq;
+}
+
+/* 錄影檔: 每幀寫固定欄位 + 實體, 與 slot 的記憶體格式相同 */
+static void record_frame(FILE* fp, const FrameSlot* f)
+{
+    size_t n = (size_t)f->n_enemies + f->n_bullets + f->n_bosses;
+    fwrite(f, offsetof(FrameSlot, entities), 1, fp);
+    fwrite(f->entities, sizeof(FrameEntity), n, fp);
+}
+
+static void report(const SpectatorStats* st, const FrameSlot* f)
+{
+    printf("[SPECTATOR] frame %u | read %u dropped %u torn %u | lag avg %.3f ms max %.3f ms | "
+        "enemies %u bullets %u bosses %u | score %d hp %d%s\n",
+        f->frame, st->read, st->dropped, st->torn,
+        st->read ? st->lag_sum_ms / st->read : 0.0, st->lag_max_ms,
+        f->n_enemies, f->n_bullets, f->n_bosses, f->score, f->hp,
+        (f->flags & FRAME_FLAG_TRUNCATED) ? " (truncated)" : "");
+    fflush(stdout);
+}
+
+static int usage(const char* prog)
+{
+    fprintf(stderr, "usage: %s [-n seconds] [-s slow_ms] [-o record.bin]\n", prog);
+    return 2;
+}
+
+int main(int argc, char* argv[])
+{
+    double seconds = 0.0;       /* 0 = 不限 */
+    long slow_ms = 0;
+    const char* record_path = NULL;
+
+    /* 不用 getopt (Windows 沒有): -n 5 與 -n5 兩種寫法都接受 */
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (arg[0] != '-' || !strchr("nso", arg[1]) || arg[1] == '\0') return usage(argv[0]);
+
+        const char* val = arg[2] ? arg + 2 : (i + 1 < argc ? argv[++i] : NULL);
+        if (!val) return usage(argv[0]);
+
+        switch (arg[1]) {
+        case 'n': seconds = atof(val); break;
+        case 's': slow_ms = atol(val); break;
+        default:  record_path = val; break;
+        }
+    }
+
+#ifdef _WIN32
+    /* 預設計時器解析度約 15.6 ms, Sleep 會遠超過 POLL_US */
+    timeBeginPeriod(1);
+#endif
+
+    FILE* rec = NULL;
+    if (record_path && !(rec = fopen(record_path, "wb"))) {
+        perror(record_path);
+        return 1;
+    }
+
+    static FrameSlot frame;     /* 約 8 KB, 不放堆疊 */
+    SpectatorStats st = { 0 };
+    const FrameShm* shm = NULL;
+    int64_t epoch = 0;
+    uint32_t last = 0;
+    int64_t start = now_us();
+    int64_t next_report = start + (int64_t)(REPORT_SEC * 1e6);
+    int waiting = 0;
+
+    while (seconds <= 0.0 || now_us() - start < (int64_t)(seconds * 1e6)) {
+        /* 連上 (或遊戲重開後重新連上) */
+        if (!shm || shm->magic != FRAME_SHM_MAGIC) {
+            if (shm) shm_detach(shm);
+            shm = shm_attach();
+            if (!shm) {
+                if (!waiting) printf("[SPECTATOR] waiting for %s ...\n", FRAME_SHM_NAME);
+                waiting = 1;
+                sleep_us(100000);
+                continue;
+            }
+            waiting = 0;
+            if (epoch != 0 && shm->epoch != epoch) st.restarts++;
+            epoch = shm->epoch;
+            last = 0;
+            printf("[SPECTATOR] attached\n");
+        }
+
+        uint32_t latest = shm->latest;
+        FRAME_SHM_FENCE();
+        if (latest == 0 || latest == last) {
+            sleep_us(POLL_US);
+            continue;
+        }
+
+        /* 永遠只讀最新的一幀; 中間沒讀到的算跳幀 */
+        if (!slot_read(shm, latest, &frame)) {
+            st.torn++;
+            continue;
+        }
+        if (last != 0 && latest > last + 1) st.dropped += latest - last - 1;
+        last = latest;
+        st.read++;
+
+        double lag = (now_us() - frame.time_us) / 1000.0;
+        st.lag_sum_ms += lag;
+        if (lag > st.lag_max_ms) st.lag_max_ms = lag;
+
+        if (rec) record_frame(rec, &frame);
+        if (slow_ms > 0) sleep_us(slow_ms * 1000);
+
+        if (now_us() >= next_report) {
+            report(&st, &frame);
+            next_report += (int64_t)(REPORT_SEC * 1e6);
+        }
+    }
+
+    if (st.read) report(&st, &frame);
+    printf("[SPECTATOR] total read %u dropped %u torn %u restarts %u\n",
+        st.read, st.dropped, st.torn, st.restarts);
+    if (rec) fclose(rec);
+    if (shm) shm_detach(shm);
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+    return 0;
+}